@@ -0,0 +1,36 @@
+#!/bin/sh
+# mkfsbench.sh - build filesystem images with growing directory sizes for
+# the fsbench lookup microbenchmark (syscalls/ece391fsbench.c).
+#
+# Usage: ./mkfsbench.sh [outdir]
+#
+# Every image holds the normal contents of fsdir/ (which must already
+# contain the converted fsbench program) padded with empty files up to
+# the requested number of directory entries.  Copy one of the generated
+# images over student-distrib/filesys_img, rebuild, boot and run
+# "fsbench" in the shell; repeat for each size to compare lookup cost.
+
+OUT=${1:-fsbench_imgs}
+SIZES="18 24 32 48 63"
+
+if [ ! -f fsdir/fsbench ]; then
+	echo "fsdir/fsbench missing: build it in syscalls/ and copy it to fsdir/"
+	exit 1
+fi
+
+mkdir -p $OUT
+for size in $SIZES; do
+	dir=$(mktemp -d)
+	cp fsdir/* $dir/
+	# one directory entry is taken by "."
+	count=$(ls $dir | wc -l)
+	pad=$((size - 1 - count))
+	i=0
+	while [ $i -lt $pad ]; do
+		touch $dir/pad$i
+		i=$((i + 1))
+	done
+	./createfs -i $dir -o $OUT/filesys_img.$size
+	rm -rf $dir
+	echo "built $OUT/filesys_img.$size ($size dentries)"
+done
@@ -0,0 +1,85 @@
+#!/usr/bin/env python3
+# profsym.py - symbolize the kernel profiler histogram.
+#
+# Usage: ./profsym.py [-k bootimg] [-n top] [profile.txt]
+#
+# Reads the text of the "profile" special file (run "cat profile" in the
+# shell and capture the output, e.g. from the serial console) from the
+# given file or stdin, looks every kernel sample up in the symbol table of
+# bootimg (nm -n) and prints the functions that got the most ticks:
+#
+#   ticks   share  function
+#     412   61.3%  sched_idle
+#      97   14.4%  putc
+#
+# User-mode samples are not in bootimg; they are summed per process as
+# "[user pid N]".  Write anything to the profile file to clear it.
+
+import argparse
+import bisect
+import subprocess
+import sys
+
+
+def load_symbols(image):
+    out = subprocess.run(["nm", "-n", image], check=True,
+                         stdout=subprocess.PIPE, universal_newlines=True).stdout
+    addrs, names = [], []
+    for line in out.splitlines():
+        parts = line.split()
+        if len(parts) != 3 or parts[1] not in "tTwW":
+            continue
+        addrs.append(int(parts[0], 16))
+        names.append(parts[2])
+    return addrs, names
+
+
+def symbolize(addrs, names, eip):
+    i = bisect.bisect_right(addrs, eip) - 1
+    if i < 0:
+        return "0x%08x" % eip
+    return names[i]
+
+
+def main():
+    ap = argparse.ArgumentParser(description="symbolize the kernel profile")
+    ap.add_argument("-k", "--kernel", default="student-distrib/bootimg",
+                    help="kernel ELF image (default: %(default)s)")
+    ap.add_argument("-n", "--top", type=int, default=30,
+                    help="functions to print (default: %(default)s)")
+    ap.add_argument("profile", nargs="?", help="captured profile text")
+    args = ap.parse_args()
+
+    addrs, names = load_symbols(args.kernel)
+    src = open(args.profile) if args.profile else sys.stdin
+    totals = {}
+    header = None
+    for line in src:
+        line = line.strip()
+        if line.startswith("# profile"):
+            header = line
+            continue
+        parts = line.split()
+        if len(parts) != 4 or not parts[0].startswith("0x"):
+            continue
+        eip, ring, pid, ticks = int(parts[0], 16), int(parts[1]), parts[2], int(parts[3])
+        if ring == 0:
+            key = symbolize(addrs, names, eip)
+        else:
+            key = "[user pid %s]" % pid
+        totals[key] = totals.get(key, 0) + ticks
+
+    if header:
+        print(header)
+    total = sum(totals.values())
+    if total == 0:
+        print("no samples")
+        return 1
+    print("%7s %7s  %s" % ("ticks", "share", "function"))
+    for key, ticks in sorted(totals.items(), key=lambda kv: -kv[1])[:args.top]:
+        print("%7d %6.1f%%  %s" % (ticks, 100.0 * ticks / total, key))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+# bench.py - boot the kernel headless in qemu with the "bench" option and
+# turn the benchmark output into JSON.  Used by "make bench".
+#
+# Usage: ./bench.py [-k bootimg] [-f filesys_img] [-o bench.json] [-t secs]
+#
+# The kernel is loaded with qemu's multiboot loader (-kernel/-initrd), so
+# no disk image or loop mount is needed.  With "bench" on the command line
+# terminal 1 runs the benchrun program instead of the shell, everything
+# written to the terminal is copied to the 0xE9 debugcon port, and qemu is
+# stopped through isa-debug-exit when benchrun is done.  Every
+# "bench <name> key=value ..." line of the output becomes one JSON record.
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def parse(text):
+    results, failed = [], None
+    for line in text.splitlines():
+        words = line.strip().split()
+        if len(words) >= 2 and words[0] == "bench":
+            rec = {"bench": words[1]}
+            for w in words[2:]:
+                key, sep, val = w.partition("=")
+                if not sep:
+                    continue
+                rec[key] = int(val) if val.lstrip("-").isdigit() else val
+            results.append(rec)
+        elif len(words) >= 3 and words[:2] == ["benchrun", "done"]:
+            failed = int(words[2].partition("=")[2])
+    return results, failed
+
+
+def main():
+    ap = argparse.ArgumentParser(description="run the kernel benchmarks in qemu")
+    ap.add_argument("-k", "--kernel", default="bootimg")
+    ap.add_argument("-f", "--fs", default="filesys_img")
+    ap.add_argument("-o", "--out", default="bench.json")
+    ap.add_argument("-t", "--timeout", type=int, default=300)
+    ap.add_argument("--qemu", default=os.environ.get("QEMU", "qemu-system-i386"))
+    args = ap.parse_args()
+
+    log = tempfile.NamedTemporaryFile(prefix="bench", suffix=".log", delete=False)
+    log.close()
+    cmd = [args.qemu, "-display", "none", "-m", "256", "-no-reboot",
+           "-kernel", args.kernel, "-initrd", args.fs, "-append", "bench",
+           "-debugcon", "file:" + log.name,
+           "-device", "isa-debug-exit,iobase=0xf4,iosize=0x04"]
+    start = time.time()
+    try:
+        proc = subprocess.run(cmd, timeout=args.timeout)
+        code = proc.returncode
+    except subprocess.TimeoutExpired:
+        code = None
+    elapsed = time.time() - start
+
+    with open(log.name, errors="replace") as f:
+        text = f.read()
+    os.unlink(log.name)
+    results, failed = parse(text)
+    # isa-debug-exit: qemu exits with (status << 1) | 1
+    status = (code >> 1) if code is not None and code & 1 else None
+    report = {
+        "kernel": args.kernel,
+        "timed_out": code is None,
+        "runner_status": status,
+        "failed_commands": failed,
+        "wall_seconds": round(elapsed, 2),
+        "results": results,
+    }
+    with open(args.out, "w") as f:
+        json.dump(report, f, indent=2)
+        f.write("\n")
+    print("%s: %d results, runner status %s%s" % (args.out, len(results), status,
+          ", timed out" if code is None else ""))
+    return 0 if status == 0 and failed == 0 else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,86 @@
+/* bootopt.c - Kernel command line options: "debugcon" mirrors terminal
+ * output to qemu's debug console, "bench" boots into the benchmark runner,
+ * "console=vga|serial|mirror" picks where putc goes
+ */
+#include "bootopt.h"
+#include "lib.h"
+#include "serial.h"
+
+uint32_t boot_flags;
+
+/*
+ *  bootopt_parse(const int8_t* cmdline)
+ *	Input: cmdline -- space separated words from the boot loader, may be NULL
+ *	Output: None
+ *  Side effect: sets boot_flags; unknown words are ignored
+ */
+void bootopt_parse(const int8_t* cmdline)
+{
+	const int8_t* word;
+	uint32_t len;
+
+	if(cmdline == NULL)
+		return;
+	while(*cmdline)
+	{
+		while(*cmdline == ' ')
+			cmdline++;
+		word = cmdline;
+		for(len = 0; word[len] != '\0' && word[len] != ' '; len++)
+			;
+		if(len == sizeof("debugcon") - 1 && strncmp(word, "debugcon", len) == 0)
+			boot_flags |= BOOT_DEBUGCON;
+		else if(len == sizeof("bench") - 1 && strncmp(word, "bench", len) == 0)
+			boot_flags |= BOOT_BENCH | BOOT_DEBUGCON;
+		else if(len == sizeof("console=serial") - 1 && strncmp(word, "console=serial", len) == 0)
+			console_sink = CONSOLE_SERIAL;
+		else if(len == sizeof("console=mirror") - 1 && strncmp(word, "console=mirror", len) == 0)
+			console_sink = CONSOLE_MIRROR;
+		else if(len == sizeof("console=vga") - 1 && strncmp(word, "console=vga", len) == 0)
+			console_sink = CONSOLE_VGA;
+		cmdline += len;
+	}
+}
+
+/*
+ *  const uint8_t* bootopt_program(int32_t terminal)
+ *	Input: terminal -- terminal being booted
+ *	Output: program name for its first process
+ *  Side effect: None
+ */
+const uint8_t* bootopt_program(int32_t terminal)
+{
+	if((boot_flags & BOOT_BENCH) && terminal == 0)
+		return (const uint8_t*)BENCH_PROGRAM;
+	return (const uint8_t*)BOOT_PROGRAM;
+}
+
+/*
+ *  debugcon_write(const uint8_t* buf, int32_t nbytes)
+ *	Input: buf, nbytes -- bytes the terminal just printed
+ *	Output: None
+ *  Side effect: one outb per byte to the debugcon port; qemu appends them
+ *	to the -debugcon chardev. No-op unless BOOT_DEBUGCON is set.
+ */
+void debugcon_write(const uint8_t* buf, int32_t nbytes)
+{
+	int32_t i;
+	if(!(boot_flags & BOOT_DEBUGCON))
+		return;
+	for(i = 0; i < nbytes; i++)
+		outb(buf[i], DEBUGCON_PORT);
+}
+
+/*
+ *  bootopt_exit(uint8_t code)
+ *	Input: code -- qemu exits with (code << 1) | 1
+ *	Output: None
+ *  Side effect: never returns
+ */
+void bootopt_exit(uint8_t code)
+{
+	cli();
+	outb(code, DEBUG_EXIT_PORT);
+	while(1)
+		asm volatile("hlt");
+}
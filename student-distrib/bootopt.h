@@ -0,0 +1,27 @@
+/* bootopt.h - Defines for the kernel command line options
+ */
+
+#ifndef BOOTOPT_H
+#define BOOTOPT_H
+
+#include "types.h"
+
+#define BOOT_DEBUGCON		0x1			// copy terminal output to the debugcon port
+#define BOOT_BENCH			0x2			// terminal index 0 runs BENCH_PROGRAM, then qemu exits
+#define DEBUGCON_PORT		0xE9		// qemu -debugcon
+#define DEBUG_EXIT_PORT		0xF4		// qemu -device isa-debug-exit,iobase=0xf4
+#define BOOT_PROGRAM		"shell"
+#define BENCH_PROGRAM		"benchrun"
+
+extern uint32_t boot_flags;
+
+/* Read the options out of the multiboot command line */
+void bootopt_parse(const int8_t* cmdline);
+/* Program the first shell of a terminal is started with */
+const uint8_t* bootopt_program(int32_t terminal);
+/* Copy terminal output to the debug console if enabled */
+void debugcon_write(const uint8_t* buf, int32_t nbytes);
+/* Leave qemu through isa-debug-exit; halts if there is none */
+void bootopt_exit(uint8_t code);
+
+#endif
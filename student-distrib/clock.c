@@ -0,0 +1,113 @@
+/* clock.c - Monotonic nanosecond clock on the time-stamp counter
+ */
+#include "clock.h"
+#include "lib.h"
+#include "pit.h"
+#include "paging.h"
+
+/* the time page; shared read-only with every process */
+static uint8_t clock_page_mem[PGE_SIZE] __attribute__((aligned(PGE_SIZE)));
+static clock_page_t* const clock_page = (clock_page_t*)clock_page_mem;
+
+/*
+ *  uint32_t clock_div64(uint64_t n, uint32_t d)
+ *	Input: n -- dividend; its high word must be below d
+ *		   d -- divisor
+ *	Output: n / d
+ *  Side effect: None; one divl, there is no libgcc for 64-bit division
+ */
+static uint32_t clock_div64(uint64_t n, uint32_t d)
+{
+	uint32_t q, r;
+	asm("divl %4" : "=a"(q), "=d"(r) : "a"((uint32_t)n), "d"((uint32_t)(n >> 32)), "rm"(d));
+	return q;
+}
+
+/*
+ *  uint32_t clock_calibrate()
+ *	Input: None
+ *	Output: tsc rate in kHz, 0 if pit channel 2 never counted down
+ *  Side effect: runs channel 2 (the speaker timer, speaker off) once for
+ *	CLOCK_CAL_COUNT counts and times it with the tsc. Channel 0 and its
+ *	interrupt are not touched.
+ */
+static uint32_t clock_calibrate()
+{
+	uint8_t saved = inb(SPEAKER_PORT);
+	uint64_t start, cycles;
+	uint32_t spins;
+
+	outb((saved & ~SPEAKER_DATA) | SPEAKER_GATE, SPEAKER_PORT);
+	outb(CONFIG_CH2_ONESHOT, PITPORT);
+	outb(CLOCK_CAL_COUNT & MASK, DATA_PORT3);
+	outb(CLOCK_CAL_COUNT >> BITSHIFT, DATA_PORT3);
+	start = rdtsc();
+	for(spins = 0; !(inb(SPEAKER_PORT) & SPEAKER_OUT2); spins++)
+	{
+		if(spins == CLOCK_CAL_SPINS)
+		{
+			outb(saved, SPEAKER_PORT);
+			return 0;
+		}
+	}
+	cycles = rdtsc() - start;
+	outb(saved, SPEAKER_PORT);
+	// khz = cycles / (CLOCK_CAL_COUNT / OSCII_FREQ seconds) / 1000
+	return clock_div64(cycles * OSCII_FREQ, CLOCK_CAL_COUNT * MS_PER_SEC);
+}
+
+/*
+ *  clock_init()
+ *	Input: None
+ *	Output: None
+ *  Side effect: calibrate the tsc, start the clock at 0 and publish the
+ *	conversion on the time page. Call with interrupts off, after paging.
+ */
+void clock_init()
+{
+	uint32_t khz = clock_calibrate();
+	if(khz == 0)
+		khz = CLOCK_FALLBACK_KHZ;
+	clock_page->tsc_khz = khz;
+	clock_page->shift = CLOCK_SHIFT;
+	clock_page->mult = clock_div64((uint64_t)NS_PER_MS << CLOCK_SHIFT, khz);
+	clock_page->tsc_base = rdtsc();
+	clock_page->version = CLOCK_PAGE_VERSION;
+	paging_map_time_page((uint32_t)clock_page_mem);
+}
+
+/*
+ *  uint64_t clock_cycles_to_ns(uint64_t cycles)
+ *	Input: cycles -- tsc cycles
+ *	Output: the same time in nanoseconds
+ *  Side effect: None; (cycles * mult) >> CLOCK_SHIFT done in 32-bit halves
+ *	so the 96-bit product never has to exist
+ */
+uint64_t clock_cycles_to_ns(uint64_t cycles)
+{
+	uint32_t mult = clock_page->mult;
+	return (((uint64_t)(uint32_t)(cycles >> 32) * mult) << (32 - CLOCK_SHIFT))
+		+ (((uint64_t)(uint32_t)cycles * mult) >> CLOCK_SHIFT);
+}
+
+/*
+ *  uint64_t clock_ns()
+ *	Input: None
+ *	Output: nanoseconds since clock_init
+ *  Side effect: None
+ */
+uint64_t clock_ns()
+{
+	return clock_cycles_to_ns(rdtsc() - clock_page->tsc_base);
+}
+
+/*
+ *  uint32_t clock_tsc_khz()
+ *	Input: None
+ *	Output: calibrated tsc rate in kHz
+ *  Side effect: None
+ */
+uint32_t clock_tsc_khz()
+{
+	return clock_page->tsc_khz;
+}
@@ -0,0 +1,41 @@
+/* clock.h - Defines used by the tsc based monotonic clock
+ */
+
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include "types.h"
+
+#define SPEAKER_PORT		0x61		// pit channel 2 gate (bit 0), speaker (bit 1), out (bit 5)
+#define SPEAKER_GATE		0x01
+#define SPEAKER_DATA		0x02
+#define SPEAKER_OUT2		0x20
+#define CONFIG_CH2_ONESHOT	0xB0		// channel 2, lo/hibyte, interrupt on terminal count, binary
+#define CLOCK_CAL_COUNT		11932		// pit counts calibrated over, about 10ms
+#define CLOCK_CAL_SPINS		0x1000000	// give up on a pit that never counts down
+#define CLOCK_FALLBACK_KHZ	1000000		// assumed tsc rate if calibration fails
+#define CLOCK_SHIFT			24			// ns = (cycles * mult) >> CLOCK_SHIFT
+#define NS_PER_MS			1000000
+#define MS_PER_SEC			1000
+#define CLOCK_PAGE_VERSION	1
+
+/* the read-only page every process sees at TIME_PAGE_VIRT */
+typedef struct clock_page_t_struct
+{
+	uint32_t version;				// CLOCK_PAGE_VERSION once calibrated, 0 before
+	uint32_t tsc_khz;				// calibrated tsc rate
+	uint32_t mult;					// ns per cycle, fixed point
+	uint32_t shift;					// CLOCK_SHIFT
+	uint64_t tsc_base;				// tsc value at clock 0
+}clock_page_t;
+
+/* Calibrate the tsc against pit channel 2 and map the time page */
+void clock_init();
+/* Nanoseconds since clock_init */
+uint64_t clock_ns();
+/* Convert a tsc cycle count to nanoseconds */
+uint64_t clock_cycles_to_ns(uint64_t cycles);
+/* Calibrated tsc rate in kHz */
+uint32_t clock_tsc_khz();
+
+#endif
@@ -8,6 +8,28 @@ inode_t* fs_inodes;
 static volatile int file_pos_keeper = 0;
 static volatile int fs_dir_read_flag = 0;
 
+/* open-addressed hash index: dentry number per slot, built once at init */
+static uint8_t dir_hash[DIR_HASH_SIZE];
+
+/*
+ *  dir_name_hash(const int8_t* name, uint32_t* len)
+ *	Input: file name, pointer to store its length
+ *	Output: length of the name, capped at FNAME_LEN
+ *  Return: FNV-1a hash of the (capped) name
+ *	Function: hash a file name the same way for index build and lookup.
+ */
+static uint32_t dir_name_hash(const int8_t* name, uint32_t* len)
+{
+	uint32_t hash = FNV_OFFSET;
+	uint32_t i;
+	for(i = 0; i < FNAME_LEN && name[i] != '\0'; i++){
+		hash ^= (uint8_t)name[i];
+		hash *= FNV_PRIME;
+	}
+	*len = i;
+	return hash;
+}
+
 /*
  *  init_filesys(uint32_t start_addr)
  *	Input: 32-bit filesystem starting address
@@ -17,12 +39,28 @@ static volatile int fs_dir_read_flag = 0;
  */
 void init_filesys(uint32_t start_addr)
 {
+	uint32_t i, slot, len;
 	fs_bootblk = start_addr;
 	uint32_t num_inode = *(uint32_t *)(start_addr + BLK_SIZE);
+	uint32_t dir_num = *(uint32_t *)start_addr;
 	fs_dentries = (dentry_t*)(start_addr + STAT_SIZE);
 	fs_inodes = (inode_t*)(start_addr + INODES_SIZE);
 	/* 1 - skip boot block */
 	fs_datablocks = start_addr + ((num_inode + 1) * INODES_SIZE);
+
+	/* build the name index; linear probing, table never more than half full */
+	for(i = 0; i < DIR_HASH_SIZE; i++){
+		dir_hash[i] = DIR_HASH_EMPTY;
+	}
+	for(i = 0; i < dir_num && i < FILE_DENTRIES; i++){
+		slot = dir_name_hash(((int8_t*)fs_dentries) + DENTRY_SIZE * i, &len) & DIR_HASH_MASK;
+		if(len == 0)
+			continue;
+		while(dir_hash[slot] != DIR_HASH_EMPTY){
+			slot = (slot + 1) & DIR_HASH_MASK;
+		}
+		dir_hash[slot] = i;
+	}
 }
 
 /*
@@ -31,34 +69,35 @@ void init_filesys(uint32_t start_addr)
  *	Output: N/A
  *  Return: 0 on success, -1 on failure.
  *	Function: Read in the directory entries according to the file name.
+ *	          Names are looked up through the hash index built in init_filesys(),
+ *	          so a miss stops at the first empty slot instead of scanning all dentries.
  */
 int32_t read_dentry_by_name (const uint8_t* fname, dentry_t* dentry)
 {
-	int i;
-	int fname_len = strlen((int8_t*)fname) > FNAME_LEN ? FNAME_LEN : strlen((int8_t*)fname);
+	uint32_t fname_len, slot;
 
-	if(fname == NULL || dentry == NULL || fname_len == 0)
+	if(fname == NULL || dentry == NULL)
 		return -1;
 
-	for(i = 0; i < FILE_DENTRIES; i++)
-	{
-		/**/
-		int8_t * dentries = ((int8_t*)fs_dentries) + DENTRY_SIZE * i;
-		//printf("fname_len: %d,pig: %d\n",fname_len, strlen(dentries));
+	slot = dir_name_hash((const int8_t*)fname, &fname_len) & DIR_HASH_MASK;
+	if(fname_len == 0)
+		return -1;
 
-		if(strlen(dentries) == fname_len || strlen(dentries) >= FNAME_LEN)
+	/* probe until the name matches or an empty slot proves a miss */
+	while(dir_hash[slot] != DIR_HASH_EMPTY)
+	{
+		int8_t * dentries = ((int8_t*)fs_dentries) + DENTRY_SIZE * dir_hash[slot];
+		// same prefix and the dentry name ends there too (or fills all 32 bytes)
+		if(strncmp((int8_t*)fname, dentries, fname_len) == 0 &&
+			(fname_len == FNAME_LEN || dentries[fname_len] == '\0'))
 		{
-
-			if(strncmp((int8_t*)fname, dentries, fname_len) == 0)
-			{
-
-				file_pos_keeper = i;
-				strcpy(dentry->file_name, dentries);
-				dentry->file_type = *(uint32_t *)(dentries + FILE_TYPE_OFFSET);
-				dentry->inode_index = *(uint32_t *)(dentries + INODE_NUM_OFFSET);
-				return 0;
-			}
+			file_pos_keeper = dir_hash[slot];
+			strncpy(dentry->file_name, dentries, FNAME_LEN);
+			dentry->file_type = *(uint32_t *)(dentries + FILE_TYPE_OFFSET);
+			dentry->inode_index = *(uint32_t *)(dentries + INODE_NUM_OFFSET);
+			return 0;
 		}
+		slot = (slot + 1) & DIR_HASH_MASK;
 	}
 	return -1;
 }
@@ -95,52 +134,141 @@ int32_t get_dentry_size(dentry_t* dentry)
 	return (*(int32_t*)(fs_bootblk + INODES_SIZE + dentry->inode_index * INODES_SIZE));
 }
 
+/*
+ *  copy_extents(inode_t* inode_ptr, uint32_t nth_blk, uint32_t byte_off, uint8_t* buf, uint32_t length)
+ *	Input: inode pointer, index of first data block in the inode, byte offset in that block,
+ *	       a uint8_t type buffer, 32-bit length needs to be copied (already clamped to file size)
+ *	Output: N/A
+ *  Return: bytes copied into buffer, -1 on a bad data block number.
+ *	Function: Copy file content block span by block span. Runs of consecutive
+ *	          DATA_BLOCKS[] numbers are contiguous in the image, so each run is
+ *	          merged into a single memcpy.
+ */
+static int32_t copy_extents(inode_t* inode_ptr, uint32_t nth_blk, uint32_t byte_off, uint8_t* buf, uint32_t length)
+{
+	uint32_t data_num = ((uint32_t*)fs_bootblk)[2];
+	uint32_t copied = 0;
+	uint32_t first, run, span;
+
+	while(copied < length){
+		first = inode_ptr->DATA_BLOCKS[nth_blk];
+		if(first >= data_num){
+			// bad datablock number (out of range)
+			return -1;
+		}
+		// bytes available from byte_off to end of first block
+		span = DATA_BLOCK_SIZE - byte_off;
+		run = 1;
+		// grow the extent while the next block directly follows in the image
+		while(span < length - copied){
+			if(inode_ptr->DATA_BLOCKS[nth_blk + run] != first + run || first + run >= data_num)
+				break;
+			span += DATA_BLOCK_SIZE;
+			run++;
+		}
+		if(span > length - copied){
+			span = length - copied;
+		}
+		memcpy(buf + copied, (uint8_t*)(fs_datablocks + (first << DATA_BLOCK_SHIFT) + byte_off), span);
+		copied += span;
+		nth_blk += run;
+		byte_off = 0;
+	}
+	return copied;
+}
+
 /*
  *  read_data (uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length)
  *	Input: 32-bit inode index, 32-bit offset, a uint8_t type buffer, 32-bit length needs to be read
  *	Output: N/A
  *  Return: bytes already read into buffer, -1 on failure, 0 on no contents to read.
- *	Function: Read in file content by inodes
+ *	Function: Read in file content by inodes, copying whole block extents at once
  */
 int32_t read_data (uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length)
 {
-	uint32_t i = 0;
 	// inode_pointer to the file
-	inode_t* inode_ptr = (inode_t*)((uint32_t)fs_inodes + inode * INODES_SIZE_HEX);
-	// index of to-be-read first data_block number
-	uint32_t nth_blk = offset / DATA_BLOCK_SIZE;
-	// first to-be-read block index in inode
-	uint32_t cur_block = inode_ptr->DATA_BLOCKS[nth_blk];
-	// first byte to be read index in the specifi data block
-	uint32_t byte_tracker = offset % DATA_BLOCK_SIZE;
+	inode_t* inode_ptr = get_inode(inode);
 	
-	// check for valid input: inode, data and null
-	if(inode >= ((int32_t*)fs_bootblk)[1] || cur_block >= ((int32_t*)fs_bootblk)[2] || buf == NULL){
+	// check for valid input: inode and null
+	if(inode_ptr == NULL || buf == NULL){
 		return -1;
 	}
 	if(offset >= inode_ptr->length){
 		return 0;
 	}
+	// stop read at end of file
+	if(length > inode_ptr->length - offset){
+		length = inode_ptr->length - offset;
+	}
+	return copy_extents(inode_ptr, offset >> DATA_BLOCK_SHIFT, offset & DATA_BLOCK_MASK, buf, length);
+}
 
-	// stop read if: reach input length; or reach end of file
-	while (i < length && i + offset < inode_ptr->length) {	
-		// parse in buffer
-		buf[i] = *((uint8_t*)(fs_datablocks + cur_block * DATA_BLOCK_SIZE + byte_tracker));
-		byte_tracker ++;
-		if(byte_tracker >= DATA_BLOCK_SIZE){		// check whether next byte in next block
-			// at 4kb block boundry
-			byte_tracker = 0;
-			nth_blk ++;
-			cur_block = inode_ptr->DATA_BLOCKS[nth_blk];
-			if(cur_block >= ((int32_t*)fs_bootblk)[2]){
-				// bad datablock number (out of range) within boundry
-				return -1;
-			}
-		}
-		i++;
+/*
+ *  get_inode(uint32_t inode)
+ *	Input: 32-bit inode index
+ *	Output: N/A
+ *  Return: pointer to the inode block, NULL if the index is out of range.
+ *	Function: Resolve an inode index to its block in the filesystem image.
+ */
+inode_t* get_inode(uint32_t inode)
+{
+	if(inode >= ((uint32_t*)fs_bootblk)[1])
+		return NULL;
+	return (inode_t*)((uint32_t)fs_inodes + inode * INODES_SIZE_HEX);
+}
+
+/*
+ *  get_data_block_addr(inode_t* inode_ptr, uint32_t nth_blk)
+ *	Input: inode pointer, index of the data block within the file
+ *	Output: N/A
+ *  Return: address of the data block in the image, 0 if the block number is bad.
+ *	Function: Locate file data in place, e.g. to map it instead of copying it.
+ */
+uint32_t get_data_block_addr(inode_t* inode_ptr, uint32_t nth_blk)
+{
+	uint32_t block;
+	if(inode_ptr == NULL || nth_blk >= DATA_BLOCK_NUMS)
+		return 0;
+	block = inode_ptr->DATA_BLOCKS[nth_blk];
+	if(block >= ((uint32_t*)fs_bootblk)[2])
+		return 0;
+	return fs_datablocks + (block << DATA_BLOCK_SHIFT);
+}
+
+/*
+ *  read_data_cursor(inode_t* inode_ptr, uint32_t* blk_idx, uint32_t* blk_off, uint8_t* buf, uint32_t length)
+ *	Input: inode pointer, cached data block index and in-block offset, a uint8_t type buffer,
+ *	       32-bit length needs to be read
+ *	Output: blk_idx and blk_off are advanced past the bytes read
+ *  Return: bytes already read into buffer, -1 on failure, 0 on end of file.
+ *	Function: Read in file content from an open file position without any
+ *	          directory lookup.
+ */
+int32_t read_data_cursor(inode_t* inode_ptr, uint32_t* blk_idx, uint32_t* blk_off, uint8_t* buf, uint32_t length)
+{
+	uint32_t pos;
+	int32_t copied;
+
+	if(inode_ptr == NULL || blk_idx == NULL || blk_off == NULL || buf == NULL){
+		return -1;
+	}
+	// current position in file from the cached cursor
+	pos = (*blk_idx << DATA_BLOCK_SHIFT) + *blk_off;
+	if(pos >= inode_ptr->length){
+		return 0;
+	}
+	// never read past end of file
+	if(length > inode_ptr->length - pos){
+		length = inode_ptr->length - pos;
+	}
+
+	copied = copy_extents(inode_ptr, *blk_idx, *blk_off, buf, length);
+	if(copied > 0){
+		pos += copied;
+		*blk_idx = pos >> DATA_BLOCK_SHIFT;
+		*blk_off = pos & DATA_BLOCK_MASK;
 	}
-	// return readed bytes
-	return i;
+	return copied;
 }
 
 /*
@@ -20,9 +20,18 @@
 #define DATA_BLOCK_NUMS   1023
 #define INODES_SIZE       4096
 #define DATA_BLOCK_SIZE   4096
+#define DATA_BLOCK_SHIFT    12
+#define DATA_BLOCK_MASK   (DATA_BLOCK_SIZE - 1)
 
 #define INODES_SIZE_HEX 0x1000
 
+/* Constants for the in-memory directory hash index */
+#define DIR_HASH_SIZE      128		/* power of two, about twice FILE_DENTRIES */
+#define DIR_HASH_MASK      (DIR_HASH_SIZE - 1)
+#define DIR_HASH_EMPTY     0xFF		/* slot holds no dentry */
+#define FNV_OFFSET         2166136261U
+#define FNV_PRIME          16777619U
+
 /* Structs for directory entries and inode blocks */
 typedef struct dentry_t_struct
 {
@@ -51,6 +60,15 @@ int32_t read_dentry_by_index (const uint32_t index, dentry_t* dentry);
 /* Read in file content by inodes */
 int32_t read_data (uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length);
 
+/* Resolve an inode index to its inode block */
+inode_t* get_inode(uint32_t inode);
+
+/* Address of the nth data block of a file inside the image */
+uint32_t get_data_block_addr(inode_t* inode_ptr, uint32_t nth_blk);
+
+/* Read file content from a cached block index / in-block offset */
+int32_t read_data_cursor(inode_t* inode_ptr, uint32_t* blk_idx, uint32_t* blk_off, uint8_t* buf, uint32_t length);
+
 /* Open the filesystem */
 int32_t filesys_open(const uint8_t* filename);
 
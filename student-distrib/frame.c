@@ -0,0 +1,147 @@
+/* frame.c - buddy allocator over the 4KB physical frames above the kernel
+ */
+#include "frame.h"
+
+/* free block lists per order, doubly linked by frame index */
+static uint16_t free_head[FRAME_MAX_ORDER + 1];
+static uint16_t free_next[FRAME_MAX_FRAMES];
+static uint16_t free_prev[FRAME_MAX_FRAMES];
+/* order of the free block starting at each frame, FRAME_USED otherwise */
+static uint8_t frame_state[FRAME_MAX_FRAMES];
+/* number of frames actually backed by memory */
+static uint32_t frame_count;
+
+frame_stats_t frame_stats;
+
+/* free_push
+ *   DESCRIPTION: put the free block starting at frame idx on its list
+ *   INPUTS: idx -- first frame of the block
+ *           order -- block size is 2^order frames
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+static void free_push(uint32_t idx, uint32_t order)
+{
+	free_prev[idx] = FRAME_NONE;
+	free_next[idx] = free_head[order];
+	if(free_head[order] != FRAME_NONE)
+		free_prev[free_head[order]] = idx;
+	free_head[order] = idx;
+	frame_state[idx] = order;
+}
+
+/* free_remove
+ *   DESCRIPTION: take the free block starting at frame idx off its list
+ *   INPUTS: idx -- first frame of the block
+ *           order -- block size is 2^order frames
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+static void free_remove(uint32_t idx, uint32_t order)
+{
+	if(free_prev[idx] != FRAME_NONE)
+		free_next[free_prev[idx]] = free_next[idx];
+	else
+		free_head[order] = free_next[idx];
+	if(free_next[idx] != FRAME_NONE)
+		free_prev[free_next[idx]] = free_prev[idx];
+	frame_state[idx] = FRAME_USED;
+}
+
+/* frame_init
+ *   DESCRIPTION: set up the allocator with the largest aligned blocks that
+ *                fit between FRAME_BASE and the end of memory
+ *   INPUTS: mem_top -- first physical address past the end of RAM
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+void frame_init(uint32_t mem_top)
+{
+	uint32_t i, order;
+
+	if(mem_top > FRAME_MEM_LIMIT)
+		mem_top = FRAME_MEM_LIMIT;
+	frame_count = (mem_top > FRAME_BASE) ? ((mem_top - FRAME_BASE) >> FRAME_SHIFT) : 0;
+
+	for(order = 0; order <= FRAME_MAX_ORDER; order++)
+		free_head[order] = FRAME_NONE;
+	for(i = 0; i < FRAME_MAX_FRAMES; i++)
+		frame_state[i] = FRAME_USED;
+
+	i = 0;
+	while(i < frame_count)
+	{
+		order = FRAME_MAX_ORDER;
+		while((i & ((1 << order) - 1)) || i + (1 << order) > frame_count)
+			order--;
+		free_push(i, order);
+		i += 1 << order;
+	}
+
+	frame_stats.total_frames = frame_count;
+	frame_stats.free_frames = frame_count;
+	frame_stats.allocs = 0;
+	frame_stats.frees = 0;
+	frame_stats.failures = 0;
+}
+
+/* frame_alloc
+ *   DESCRIPTION: take the smallest free block that is big enough and split
+ *                it down, returning the unused halves to their lists
+ *   INPUTS: order -- number of frames wanted is 2^order
+ *   OUTPUTS: none
+ *   RETURN VALUE: physical address of the block, 0 if none is free
+ */
+uint32_t frame_alloc(uint32_t order)
+{
+	uint32_t o, idx;
+
+	for(o = order; o <= FRAME_MAX_ORDER && free_head[o] == FRAME_NONE; o++);
+	if(o > FRAME_MAX_ORDER)
+	{
+		frame_stats.failures++;
+		return 0;
+	}
+	idx = free_head[o];
+	free_remove(idx, o);
+	while(o > order)
+	{
+		o--;
+		free_push(idx + (1 << o), o);
+	}
+	frame_stats.free_frames -= 1 << order;
+	frame_stats.allocs++;
+	return FRAME_BASE + (idx << FRAME_SHIFT);
+}
+
+/* frame_free
+ *   DESCRIPTION: return a block and merge it with its buddy for as long as
+ *                the buddy is free and of the same size
+ *   INPUTS: addr -- address returned by frame_alloc
+ *           order -- order it was allocated with
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+void frame_free(uint32_t addr, uint32_t order)
+{
+	uint32_t idx, buddy;
+
+	if(addr < FRAME_BASE || order > FRAME_MAX_ORDER)
+		return;
+	idx = (addr - FRAME_BASE) >> FRAME_SHIFT;
+	if(idx >= frame_count || (idx & ((1 << order) - 1)))
+		return;
+
+	frame_stats.free_frames += 1 << order;
+	frame_stats.frees++;
+	while(order < FRAME_MAX_ORDER)
+	{
+		buddy = idx ^ (1 << order);
+		if(buddy >= frame_count || frame_state[buddy] != order)
+			break;
+		free_remove(buddy, order);
+		idx &= ~(1 << order);
+		order++;
+	}
+	free_push(idx, order);
+}
@@ -0,0 +1,39 @@
+/* frame.h - physical page frame allocator
+ */
+
+#ifndef FRAME_H
+#define FRAME_H
+
+#include "types.h"
+
+/* managed physical memory: everything above the kernel page up to the
+ * first user virtual address, which the kernel maps one to one */
+#define FRAME_BASE				0x00800000
+#define FRAME_MEM_LIMIT			0x08000000
+#define FRAME_SIZE				0x1000
+#define FRAME_SHIFT				12
+#define FRAME_MAX_FRAMES		((FRAME_MEM_LIMIT - FRAME_BASE) >> FRAME_SHIFT)
+#define FRAME_MAX_ORDER			10			/* largest block: 1024 frames = 4MB */
+#define FRAME_NONE				0xFFFF		/* end of a free list */
+#define FRAME_USED				0xFF		/* frame is not the head of a free block */
+
+/* allocator counters, in frames */
+typedef struct frame_stats_t_struct
+{
+	uint32_t total_frames;
+	uint32_t free_frames;
+	uint32_t allocs;
+	uint32_t frees;
+	uint32_t failures;
+}frame_stats_t;
+
+extern frame_stats_t frame_stats;
+
+/* Hand all frames between FRAME_BASE and mem_top to the allocator */
+void frame_init(uint32_t mem_top);
+/* Allocate 2^order contiguous, naturally aligned frames; 0 if out of memory */
+uint32_t frame_alloc(uint32_t order);
+/* Give back a block from frame_alloc with the same order */
+void frame_free(uint32_t addr, uint32_t order);
+
+#endif
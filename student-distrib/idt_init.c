@@ -6,6 +6,7 @@
 #include "rtc.h"
 #include "syscall.h"
 #include "pit.h"
+#include "paging.h"
 
 /*
  * _idt_set_all()
@@ -59,7 +60,7 @@ _idt_set_all()	 												/* first, set all as interrupt gate */
 	SET_IDT_ENTRY(idt[FDWG_TRAP_NP], _idt_handle_exception_FDWG_TRAP_NP);
 	SET_IDT_ENTRY(idt[FDWG_TRAP_SS], _idt_handle_exception_FDWG_TRAP_SS);
 	SET_IDT_ENTRY(idt[FDWG_TRAP_GP], _idt_handle_exception_FDWG_TRAP_GP);
-	SET_IDT_ENTRY(idt[FDWG_TRAP_PF], _idt_handle_exception_FDWG_TRAP_PF);							// testing: wrong!
+	SET_IDT_ENTRY(idt[FDWG_TRAP_PF], exception_pf);
 	SET_IDT_ENTRY(idt[FDWG_TRAP_SPURIOUS], _idt_handle_exception_FDWG_TRAP_SPURIOUS);
 	SET_IDT_ENTRY(idt[FDWG_TRAP_MF], _idt_handle_exception_FDWG_TRAP_MF);
 	SET_IDT_ENTRY(idt[FDWG_TRAP_AC], _idt_handle_exception_FDWG_TRAP_AC);
@@ -71,6 +72,7 @@ _idt_set_all()	 												/* first, set all as interrupt gate */
 	SET_IDT_ENTRY(idt[FDWG_TRAP_KB], interrupt_kb);
 	SET_IDT_ENTRY(idt[FDWG_TRAP_RTC], interrupt_rtc);
 	SET_IDT_ENTRY(idt[FDWG_TRAP_MOUSE], interrupt_mouse);
+	SET_IDT_ENTRY(idt[FDWG_TRAP_COM1], interrupt_serial);
 
 	// syscall entry setup
 	SET_IDT_ENTRY(idt[FDWG_SYS_CALL], syscall);			// before exec, syscall num in eax
@@ -162,6 +164,23 @@ void _idt_handle_exception_FDWG_TRAP_PF()		{
 	printf("faulting at addr 0x%#x\n", fault_addr);
 	halt(255);
 }
+/*
+ * _idt_page_fault_handler(uint32_t error_code)
+ * Args: error_code - page fault error code pushed by the cpu
+ * Return val: None
+ * Side Effect: resolves demand and copy-on-write faults on program image
+ *				pages; any other fault is reported and the program halted
+ */
+void _idt_page_fault_handler(uint32_t error_code)	{
+	uint32_t fault_addr;
+	uint64_t start = rdtsc();
+	asm volatile("\t mov %%cr2,%0" : "=r"(fault_addr));
+	if(program_page_fault(fault_addr, error_code) == 0){
+		paging_stats.fault_cycles += rdtsc() - start;
+		return;
+	}
+	_idt_handle_exception_FDWG_TRAP_PF();
+}
 void _idt_handle_exception_FDWG_TRAP_SPURIOUS()	{
 	clear();
 	printf("Spurious Interrupt.");
@@ -20,7 +20,8 @@ extern void interrupt_kb();
 extern void interrupt_rtc();
 extern void interrupt_pit();
 extern void interrupt_mouse();
-// extern void exception_pf();
+extern void interrupt_serial();
+extern void exception_pf();
 
 /* IDT entry table set-up */
 extern void _idt_set_all();
@@ -42,7 +43,8 @@ void _idt_handle_exception_FDWG_TRAP_TS();
 void _idt_handle_exception_FDWG_TRAP_NP();		
 void _idt_handle_exception_FDWG_TRAP_SS();		
 void _idt_handle_exception_FDWG_TRAP_GP();		
-void _idt_handle_exception_FDWG_TRAP_PF();		
+void _idt_handle_exception_FDWG_TRAP_PF();
+void _idt_page_fault_handler(uint32_t error_code);		
 void _idt_handle_exception_FDWG_TRAP_SPURIOUS();	
 void _idt_handle_exception_FDWG_TRAP_MF();		
 void _idt_handle_exception_FDWG_TRAP_AC();		
@@ -77,6 +79,7 @@ enum {
 
 	FDWG_TRAP_PIT =   0x20,  		/* 0x20, PIT interrupt */
 	FDWG_TRAP_KB = 	  0x21, 	 	/* 0x21, keyboard interrupt */
+	FDWG_TRAP_COM1 =  0x24,			/* 0x24, COM1 serial interrupt */
 	FDWG_TRAP_RTC =   0x28, 	 	/* 0x28, RTC interrupt */
 	FDWG_TRAP_MOUSE = 0x2C,			/* 0x2C, mouse interrupt */
 
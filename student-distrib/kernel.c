@@ -11,15 +11,23 @@
 #include "idt_init.h"
 #include "rtc.h"
 #include "paging.h"
+#include "frame.h"
+#include "kmalloc.h"
 #include "terminal.h"
 #include "filesys.h"
 #include "syscall.h"
 #include "pit.h"
+#include "clock.h"
+#include "bootopt.h"
+#include "serial.h"
 #include "mouse.h"
 
 /* Macros. */
 /* Check if the bit BIT in FLAGS is set. */
 #define CHECK_FLAG(flags,bit)   ((flags) & (1 << (bit)))
+/* mem_upper counts KB above the first 1MB */
+#define MEM_UPPER_BASE			0x100000
+#define KB_SHIFT				10
 
 
 extern int8_t* interface;
@@ -32,6 +40,7 @@ entry (unsigned long magic, unsigned long addr)
 	_idt_set_all();
 	multiboot_info_t *mbi;
 	uint32_t fs_start;
+	uint32_t mem_top = FRAME_MEM_LIMIT;		// assume 128MB unless told otherwise
 
 	/* Clear the screen. */
 	clear();
@@ -50,17 +59,22 @@ entry (unsigned long magic, unsigned long addr)
 	printf ("flags = 0x%#x\n", (unsigned) mbi->flags);
 
 	/* Are mem_* valid? */
-	if (CHECK_FLAG (mbi->flags, 0))
+	if (CHECK_FLAG (mbi->flags, 0)) {
 		printf ("mem_lower = %uKB, mem_upper = %uKB\n",
 				(unsigned) mbi->mem_lower, (unsigned) mbi->mem_upper);
+		if (mbi->mem_upper < (FRAME_MEM_LIMIT >> KB_SHIFT))
+			mem_top = MEM_UPPER_BASE + (mbi->mem_upper << KB_SHIFT);
+	}
 
 	/* Is boot_device valid? */
 	if (CHECK_FLAG (mbi->flags, 1))
 		printf ("boot_device = 0x%#x\n", (unsigned) mbi->boot_device);
 
 	/* Is the command line passed? */
-	if (CHECK_FLAG (mbi->flags, 2))
+	if (CHECK_FLAG (mbi->flags, 2)) {
 		printf ("cmdline = %s\n", (char *) mbi->cmdline);
+		bootopt_parse((const int8_t*) mbi->cmdline);
+	}
 
 	if (CHECK_FLAG (mbi->flags, 3)) {
 		int mod_count = 0;
@@ -165,6 +179,12 @@ entry (unsigned long magic, unsigned long addr)
 	/* Init paging */
 	init_paging();
 
+	/* Init physical frame allocator */
+	frame_init(mem_top);
+
+	/* Init kernel heap */
+	kmalloc_init();
+
 	/* Init file system */
 	init_filesys(fs_start);
 
@@ -177,12 +197,18 @@ entry (unsigned long magic, unsigned long addr)
 	/* Init rtc */
 	rtc_init();
 
+	/* Init COM1; console output may already be queued for it */
+	serial_init();
+
 	/* Init mouse */
 	mouse_init();
 
 	/* Init pit */
 	pit_init();
 
+	/* Calibrate the tsc clock, map the time page */
+	clock_init();
+
 	/* Init pcb */
 	pcb_init();
 
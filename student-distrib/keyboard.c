@@ -8,6 +8,8 @@
 #include "paging.h"
 #include "syscall.h"
 #include "terminal.h"
+#include "sche.h"
+#include "serial.h"
 
 
 /* flags controlling CAPS_LOCK, SHIFT and CONTROL*/
@@ -16,21 +18,22 @@ volatile int shift_flag;
 volatile int control_flag;
 volatile int alt_flag;
 volatile int enter_flag;	// fn flag for enter_change_line enable
-volatile int cross_enter_flag;
 int rtc_test_mode; //rtc test case : control + 4
 uint8_t rtc_count;
 
-/* keyboard buffer related info */
-uint8_t keyboard_buffer[BUF_SIZE];
+/* line being typed on the shown terminal: points into its ter_info */
+uint8_t* keyboard_buffer = (uint8_t*)terminal_array[0].keyboard_buffer;
 volatile uint8_t kb_buffer_position;
 
-extern uint32_t enter_tracker[TRACKER_SIZE];
+/* raw scan codes from the interrupt, decoded by keyboard_drain() */
+static uint8_t kb_ring[KB_RING_SIZE];
+static volatile uint32_t kb_ring_head, kb_ring_tail;
+static volatile uint32_t kb_draining;
+
+extern uint32_t* enter_tracker;
 extern int8_t* interface;
 extern int8_t* text_mode_interface;
 extern int first_scroll_indicator;					// only useful in text editing mode
-extern uint8_t ter_read_buffer[BUF_SIZE];
-extern uint8_t ter_read_buf_size;
-extern uint8_t ter_read_indicator;
 
 extern volatile uint8_t runn_task_num;		// range from 0 - 6
 extern volatile uint8_t curr_task_pos;		// current task position indicator; 0 as first task shell 
@@ -53,7 +56,6 @@ void keyboard_init()
 	control_flag = 0;
 	alt_flag = 0;
 	enter_flag = 0;
-	cross_enter_flag = 0;
 	rtc_test_mode = 0;
 	rtc_count = 1;
 	// clear the keyboard buffer
@@ -103,20 +105,24 @@ void keyboard_buffer_edit(uint8_t indicator, uint8_t data){
 
 	}else if(indicator==3){		// normal mode enter; also need to copy buffer for terminal read
 
-		if(ter_read_indicator == 1){
-			int i = 0;
-			for(i = 0; i < BUF_SIZE; i++){
-				ter_read_buffer[i] = keyboard_buffer[i];	// note: this buf does not contains '/n'
-			}
-
-			if(kb_buffer_position<BUF_SIZE){	// still have space (for read to add '/n'); else ter_read_buffer is full
-				ter_read_buffer[kb_buffer_position] = '\n';
-				ter_read_buffer[kb_buffer_position+1] = '\0';
-				ter_read_buf_size = kb_buffer_position + 1;
-			}else{
-				ter_read_buf_size = BUF_SIZE;
+		// the line goes into the shown terminal's input queue, read or not yet
+		ter_info* ter = &terminal_array[current_terminal_idx];
+		uint32_t len = kb_buffer_position;
+		if(ter->in_head - ter->in_tail + len + 1 <= TERM_INPUT_SIZE){	// whole lines only
+			uint32_t i;
+			for(i = 0; i < len; i++){
+				ter->input[(ter->in_head + i) & (TERM_INPUT_SIZE - 1)] = keyboard_buffer[i];
 			}
-			cross_enter_flag = 1;
+			ter->input[(ter->in_head + len) & (TERM_INPUT_SIZE - 1)] = '\n';
+			// publish the bytes before the line count the reader waits on;
+			// the wakeup touches the run queues, so interrupts go off for it
+			uint32_t flags;
+			cli_and_save(flags);
+			ter->in_head += len + 1;
+			ter->lines_in++;
+			sched_wake_all(&ter->read_wait);
+			sched_credit_terminal(current_terminal_idx);	// reader answers before cpu hogs
+			restore_flags(flags);
 		}
 		keyboard_buffer_reset();
 		putc('\n');
@@ -124,6 +130,35 @@ void keyboard_buffer_edit(uint8_t indicator, uint8_t data){
 	return;
 }
 
+/* Scan code -> ASCII tables, 10 natural numbers and 26 characters each.
+ * Note: all zeros are keyboard keys not printable
+ */
+static const uint8_t ascii_array[PRINT_TABLE_SIZE] = 	// this 54 is the size of the scan-code table until key /
+{
+	0,0,						
+	'1','2','3','4','5','6','7','8','9','0',
+	'-','=',0,0,
+	'q','w','e','r','t','y','u','i','o','p',
+	'[',']',0,0,
+	'a','s','d','f','g','h','j','k','l',
+	';',SINGLE_QUA,'`',0,BACKSLASH,
+	'z','x','c','v','b','n','m',
+	',','.','/'
+};
+/* the same when shift key is pressed */
+static const uint8_t shift_array[PRINT_TABLE_SIZE] = 	// this 54 is the size of the scan-code table with shift key pressed /
+{
+	0,0,						
+	'!','@','#','$','%','^','&','*','(',')',
+	'_','+',0,0,
+	'Q','W','E','R','T','Y','U','I','O','P',
+	'{','}',0,0,
+	'A','S','D','F','G','H','J','K','L',
+	':','"','~',0,'|',
+	'Z','X','C','V','B','N','M',
+	'<','>','?'
+};
+
 /*
  *  ascii(uint8_t scan_code)
  *	Input: 8-bit scan_code
@@ -137,22 +172,6 @@ uint8_t ascii(uint8_t scan_code)
 		return -1;	//return unprintable
 
 	uint8_t ret;
-	/* Create a char array to store 10 natural numbers and 26 capital characters.
-	 * Note: all zeros are keyboard keys not printable
-	 */
-	uint8_t ascii_array[PRINT_TABLE_SIZE] = 	// this 54 is the size of the scan-code table until key /
-	{
-		0,0,						
-		'1','2','3','4','5','6','7','8','9','0',
-		'-','=',0,0,
-		'q','w','e','r','t','y','u','i','o','p',
-		'[',']',0,0,
-		'a','s','d','f','g','h','j','k','l',
-		';',SINGLE_QUA,'`',0,BACKSLASH,
-		'z','x','c','v','b','n','m',
-		',','.','/'
-	};
-
 	//store corresponding ASCII value in ret value
 	ret = ascii_array[scan_code]; 
 	if (cap_flag == 1)
@@ -176,41 +195,37 @@ uint8_t	shift(uint8_t scan_code)
 	if(scan_code >= PRINT_TABLE_SIZE)
 		return -1;	//return unprintable
 
-	uint8_t ret;
-	/* Create a char array to store 10 natural numbers and 26 capital characters.
-	 * when shift key is pressed
-	 * Note: all zeros are keyboard keys not printable
-	 */
-	uint8_t shift_array[PRINT_TABLE_SIZE] = 	// this 54 is the size of the scan-code table with shift key pressed /
-	{
-		0,0,						
-		'!','@','#','$','%','^','&','*','(',')',
-		'_','+',0,0,
-		'Q','W','E','R','T','Y','U','I','O','P',
-		'{','}',0,0,
-		'A','S','D','F','G','H','J','K','L',
-		':','"','~',0,'|',
-		'Z','X','C','V','B','N','M',
-		'<','>','?'
-	};
-
 	//store corresponding ASCII value in ret value
-	ret = shift_array[scan_code];
-	return ret;
+	return shift_array[scan_code];
 }
 
 /*
- *  get_char()
- *	Input: None
- *	Output: get scan code from port
+ *  keyboard_decode(uint8_t input)
+ *	Input: input -- scan code taken from the scan code ring
+ *	Output: ascii value of a key to type, 0 if the key was a command or
+ *	only changed the modifier state
  */
-uint8_t get_char()
+uint8_t keyboard_decode(uint8_t input)
 {
-	uint32_t input;
 	uint8_t ret;
-	//keep reading from 0X60 PORT until valid scan code is got
+	// one pass; break leaves for the commands
 	do{ 
-		input = inb(KEYB_PORT);
+		//shift+pgup/pgdn: page through the scrollback
+		if(shift_flag == 1 && input == PAGE_UP)
+		{
+			terminal_scroll(SCROLLBACK_PAGE);
+			break;
+		}
+		if(shift_flag == 1 && input == PAGE_DOWN)
+		{
+			terminal_scroll(-SCROLLBACK_PAGE);
+			break;
+		}
+		//any other key press returns to the live screen
+		if(input < KEY_RELEASE_ADD && input != L_SHIFT && input != R_SHIFT)
+		{
+			terminal_scroll_live();
+		}
 
 		if(input == ENTER){
 
@@ -362,38 +377,94 @@ uint8_t get_char()
 		}
 		//return scan code
 		return ret;
-	}while(1);
+	}while(0);
 	return 0;
 }
 
+/*
+ *  keyboard_drain()
+ *	Input: None
+ *	Output: None
+ *  Side effect: decode the scan codes in the ring, and the bytes typed on
+ *	the serial console, and act on them. Called with interrupts off after
+ *	the EOI of the keyboard or serial interrupt; only taking an entry from
+ *	a ring runs with interrupts off, the decoding, echo and line editing
+ *	run with them on. An interrupt that finds the input already being
+ *	drained only queues its byte, so there is a single consumer and the
+ *	keyboard and serial never edit the line or the console at the same
+ *	time. The last empty check and clearing kb_draining both happen with
+ *	interrupts off, so nothing is left behind. The tick may not switch
+ *	away meanwhile: this can run on the idle or launch stack, which the
+ *	scheduler starts over.
+ */
+void keyboard_drain()
+{
+	uint8_t input;
+	uint8_t output;		//ascii value
+
+	if(kb_draining)
+		return;
+	kb_draining = 1;
+	sched_preempt_off++;
+	while(1)
+	{
+		if(kb_ring_tail != kb_ring_head)
+		{
+			input = kb_ring[kb_ring_tail & (KB_RING_SIZE - 1)];
+			kb_ring_tail++;
+			sti();
+
+			// echo and key commands draw on the shown terminal, not the interrupted process's
+			console_echo = 1;
+			output = keyboard_decode(input);
+			//set valid output 
+			if(output >= PRINTABLE_START && output <= PRINTABLE_END && output != 0){
+				// this only deal with non-special single printable char
+				// also, store current char in buffer
+				// 1 to add the printable character to buffer
+				keyboard_buffer_edit(1, output);
+			}
+		}
+		else if(serial_rx_pop(&input))
+		{
+			sti();
+			console_echo = 1;
+			serial_rx_key(input);
+		}
+		else
+		{
+			break;
+		}
+		console_echo = 0;
+		cli();
+	}
+	sched_preempt_off--;
+	kb_draining = 0;
+}
+
 /*
  *  _idt_keyboard_irq_handler()
  *	Input: None
  *	Output: None
- *  Side effect: handle the keyboard interrupt properly
+ *  Side effect: handle the keyboard interrupt properly: the scan code only
+ *	goes into the ring here, decoding happens after the EOI
  */
 void _idt_keyboard_irq_handler()
 {
 	// disable interrupt
 	cli();
 
-	uint8_t output;		//ascii value
-
-	output = get_char();
+	uint8_t input = inb(KEYB_PORT);
 
-	//set valid output 
-	if(output >= PRINTABLE_START && output <= PRINTABLE_END && output != 0){
-		// this only deal with non-special single printable char
-		// also, store current char in buffer
-		// 1 to add the printable character to buffer
-		keyboard_buffer_edit(1, output);
+	// single producer: only this handler moves kb_ring_head
+	if(kb_ring_head - kb_ring_tail < KB_RING_SIZE){
+		kb_ring[kb_ring_head & (KB_RING_SIZE - 1)] = input;
+		kb_ring_head++;
 	}
 
 	// re-enable the IRQ 1
 	send_eoi(IRQ1);
+	keyboard_drain();
 	// re-able interrupts
 	sti();
 }
-
-
-
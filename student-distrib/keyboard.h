@@ -39,6 +39,8 @@
 #define FONEKEY							0x3B		/* scan code of F1 */
 #define FTWOKEY							0x3C		/* scan code of F2 */
 #define FTHREEKEY						0x3D		/* scan code of F3 */
+#define PAGE_UP							0x49		/* scan code of page up */
+#define PAGE_DOWN						0x51		/* scan code of page down */
 						
 
 /* defined scan code of test cases key */
@@ -52,6 +54,7 @@
 #define BUF_SIZE						128			/* size of line buffer */
 #define PRINT_TABLE_SIZE				54			/* size of the ascii table and shift table */
 #define TRACKER_SIZE					25			/* size of the enter key tracker */
+#define KB_RING_SIZE					64			/* scan codes queued by the interrupt, power of 2 */
 
 /* Initialize keyboard */
 void keyboard_init();
@@ -61,8 +64,10 @@ void keyboard_buffer_edit(uint8_t indicator, uint8_t data);
 uint8_t ascii(uint8_t scan_code);
 /* Transfer scan code into ascii value when shift is pressed */
 uint8_t shift(uint8_t scan_code);
-/* Get input scan code from keyboard */
-uint8_t get_char();
+/* Decode queued keyboard and serial input; from the interrupt handlers after the EOI */
+void keyboard_drain();
+/* Act on one scan code; returns the ascii value of a key to type, or 0 */
+uint8_t keyboard_decode(uint8_t input);
 
 
 /* the keyboard interrupt handler */
@@ -0,0 +1,302 @@
+/* kmalloc.c - kernel heap: size-class slab caches over the frame allocator
+ */
+#include "kmalloc.h"
+#include "lib.h"
+
+/* lists a slab can be on */
+#define SLAB_PARTIAL	0
+#define SLAB_FULL		1
+#define SLAB_EMPTY		2
+#define SLAB_LISTS		3
+
+/* header at the start of every slab frame */
+typedef struct slab_t_struct
+{
+	uint16_t magic;
+	uint16_t cls;				// size class index
+	uint16_t inuse;
+	uint16_t list;				// SLAB_PARTIAL/FULL/EMPTY
+	void* free;					// free objects, linked through their first word
+	struct slab_t_struct* next;
+	struct slab_t_struct* prev;
+}slab_t;
+
+/* header in front of a whole-frame allocation */
+typedef struct big_hdr_t_struct
+{
+	uint16_t magic;
+	uint16_t order;
+}big_hdr_t;
+
+/* slab lists of every size class */
+static slab_t* slab_lists[KMALLOC_CLASSES][SLAB_LISTS];
+/* objects per slab of every size class */
+static uint16_t slab_capacity[KMALLOC_CLASSES];
+/* current boot arena chunk */
+static uint8_t* arena_next;
+static uint8_t* arena_end;
+
+kmalloc_stats_t kmalloc_stats;
+
+/* slab_link
+ *   DESCRIPTION: put a slab at the head of one of its class lists
+ *   INPUTS: slab -- the slab
+ *           list -- SLAB_PARTIAL/FULL/EMPTY
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+static void slab_link(slab_t* slab, uint32_t list)
+{
+	slab_t** head = &slab_lists[slab->cls][list];
+	slab->list = list;
+	slab->prev = NULL;
+	slab->next = *head;
+	if(*head != NULL)
+		(*head)->prev = slab;
+	*head = slab;
+}
+
+/* slab_unlink
+ *   DESCRIPTION: take a slab off the list it is on
+ *   INPUTS: slab -- the slab
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+static void slab_unlink(slab_t* slab)
+{
+	if(slab->prev != NULL)
+		slab->prev->next = slab->next;
+	else
+		slab_lists[slab->cls][slab->list] = slab->next;
+	if(slab->next != NULL)
+		slab->next->prev = slab->prev;
+}
+
+/* slab_grow
+ *   DESCRIPTION: carve a new frame into objects of one size class
+ *   INPUTS: cls -- size class index
+ *   OUTPUTS: new slab is put on the empty list
+ *   RETURN VALUE: the slab, NULL if out of memory
+ */
+static slab_t* slab_grow(uint32_t cls)
+{
+	uint32_t size = kmalloc_stats.classes[cls].obj_size;
+	uint8_t* obj;
+	slab_t* slab;
+	int i;
+
+	slab = (slab_t*)frame_alloc(0);
+	if(slab == NULL)
+		return NULL;
+	slab->magic = SLAB_MAGIC;
+	slab->cls = cls;
+	slab->inuse = 0;
+	slab->free = NULL;
+	/* thread the free list back to front so objects go out in address order */
+	obj = (uint8_t*)slab + SLAB_HDR_SIZE + (slab_capacity[cls] - 1) * size;
+	for(i = 0; i < slab_capacity[cls]; i++, obj -= size)
+	{
+		*(void**)obj = slab->free;
+		slab->free = obj;
+	}
+	slab_link(slab, SLAB_EMPTY);
+	kmalloc_stats.classes[cls].slabs++;
+	return slab;
+}
+
+/* kmalloc_init
+ *   DESCRIPTION: set up the size classes; slabs are grown on demand
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+void kmalloc_init()
+{
+	int i, j;
+
+	memset(&kmalloc_stats, 0, sizeof(kmalloc_stats));
+	for(i = 0; i < KMALLOC_CLASSES; i++)
+	{
+		kmalloc_stats.classes[i].obj_size = 1 << (KMALLOC_MIN_SHIFT + i);
+		slab_capacity[i] = (FRAME_SIZE - SLAB_HDR_SIZE) >> (KMALLOC_MIN_SHIFT + i);
+		for(j = 0; j < SLAB_LISTS; j++)
+			slab_lists[i][j] = NULL;
+	}
+	arena_next = NULL;
+	arena_end = NULL;
+}
+
+/* kmalloc
+ *   DESCRIPTION: allocate from the smallest size class that fits, or whole
+ *                frames for requests above KMALLOC_MAX_SIZE
+ *   INPUTS: size -- bytes wanted
+ *   OUTPUTS: none
+ *   RETURN VALUE: 16-byte aligned memory, NULL if size is 0 or out of memory
+ */
+void* kmalloc(uint32_t size)
+{
+	uint32_t cls, order, flags;
+	slab_t* slab;
+	big_hdr_t* big;
+	void* obj;
+
+	if(size == 0)
+		return NULL;
+
+	cli_and_save(flags);
+	if(size > KMALLOC_MAX_SIZE)
+	{
+		for(order = 0; order <= FRAME_MAX_ORDER && (FRAME_SIZE << order) < size + BIG_HDR_SIZE; order++);
+		big = (order <= FRAME_MAX_ORDER) ? (big_hdr_t*)frame_alloc(order) : NULL;
+		if(big == NULL)
+		{
+			kmalloc_stats.failures++;
+			restore_flags(flags);
+			return NULL;
+		}
+		big->magic = BIG_MAGIC;
+		big->order = order;
+		kmalloc_stats.big_allocs++;
+		kmalloc_stats.big_frames += 1 << order;
+		restore_flags(flags);
+		return (uint8_t*)big + BIG_HDR_SIZE;
+	}
+
+	for(cls = 0; (1U << (KMALLOC_MIN_SHIFT + cls)) < size; cls++);
+	slab = slab_lists[cls][SLAB_PARTIAL];
+	if(slab == NULL)
+		slab = slab_lists[cls][SLAB_EMPTY];
+	if(slab == NULL)
+		slab = slab_grow(cls);
+	if(slab == NULL)
+	{
+		kmalloc_stats.failures++;
+		restore_flags(flags);
+		return NULL;
+	}
+
+	obj = slab->free;
+	slab->free = *(void**)obj;
+	slab->inuse++;
+	slab_unlink(slab);
+	slab_link(slab, (slab->inuse == slab_capacity[cls]) ? SLAB_FULL : SLAB_PARTIAL);
+	kmalloc_stats.classes[cls].inuse++;
+	kmalloc_stats.classes[cls].allocs++;
+	restore_flags(flags);
+	return obj;
+}
+
+/* kzalloc
+ *   DESCRIPTION: kmalloc and clear
+ *   INPUTS: size -- bytes wanted
+ *   OUTPUTS: none
+ *   RETURN VALUE: zeroed memory, NULL if out of memory
+ */
+void* kzalloc(uint32_t size)
+{
+	void* ptr = kmalloc(size);
+	if(ptr != NULL)
+		memset(ptr, 0, size);
+	return ptr;
+}
+
+/* kfree
+ *   DESCRIPTION: return memory to its slab, keeping at most one empty slab
+ *                per class; whole-frame allocations go back to the frame
+ *                allocator. Pointers that were not handed out are counted
+ *                and ignored.
+ *   INPUTS: ptr -- memory from kmalloc, or NULL
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+void kfree(void* ptr)
+{
+	slab_t* slab;
+	big_hdr_t* big;
+	uint32_t cls, flags;
+
+	if(ptr == NULL)
+		return;
+
+	cli_and_save(flags);
+	slab = (slab_t*)((uint32_t)ptr & ~(FRAME_SIZE - 1));
+	if(slab->magic == BIG_MAGIC && (uint8_t*)ptr == (uint8_t*)slab + BIG_HDR_SIZE)
+	{
+		big = (big_hdr_t*)slab;
+		big->magic = 0;
+		kmalloc_stats.big_frees++;
+		kmalloc_stats.big_frames -= 1 << big->order;
+		frame_free((uint32_t)big, big->order);
+		restore_flags(flags);
+		return;
+	}
+	if(slab->magic != SLAB_MAGIC || slab->cls >= KMALLOC_CLASSES
+		|| (((uint32_t)ptr - (uint32_t)slab - SLAB_HDR_SIZE) & (kmalloc_stats.classes[slab->cls].obj_size - 1)))
+	{
+		kmalloc_stats.bad_frees++;
+		restore_flags(flags);
+		return;
+	}
+
+	cls = slab->cls;
+	*(void**)ptr = slab->free;
+	slab->free = ptr;
+	slab->inuse--;
+	kmalloc_stats.classes[cls].inuse--;
+	kmalloc_stats.classes[cls].frees++;
+	slab_unlink(slab);
+	if(slab->inuse != 0)
+	{
+		slab_link(slab, SLAB_PARTIAL);
+	}
+	else if(slab_lists[cls][SLAB_EMPTY] == NULL)
+	{
+		slab_link(slab, SLAB_EMPTY);
+	}
+	else
+	{
+		slab->magic = 0;
+		kmalloc_stats.classes[cls].slabs--;
+		frame_free((uint32_t)slab, 0);
+	}
+	restore_flags(flags);
+}
+
+/* kboot_alloc
+ *   DESCRIPTION: bump allocation for structures that are never freed;
+ *                the arena grows in KBOOT_CHUNK_ORDER frame blocks
+ *   INPUTS: size -- bytes wanted
+ *   OUTPUTS: none
+ *   RETURN VALUE: zeroed 16-byte aligned memory, NULL if out of memory
+ */
+void* kboot_alloc(uint32_t size)
+{
+	uint32_t order, flags;
+	uint8_t* ptr;
+
+	if(size == 0)
+		return NULL;
+	size = (size + KMALLOC_ALIGN - 1) & ~(KMALLOC_ALIGN - 1);
+
+	cli_and_save(flags);
+	if(arena_next == NULL || size > (uint32_t)(arena_end - arena_next))
+	{
+		for(order = KBOOT_CHUNK_ORDER; order <= FRAME_MAX_ORDER && (FRAME_SIZE << order) < size; order++);
+		ptr = (order <= FRAME_MAX_ORDER) ? (uint8_t*)frame_alloc(order) : NULL;
+		if(ptr == NULL)
+		{
+			kmalloc_stats.failures++;
+			restore_flags(flags);
+			return NULL;
+		}
+		kmalloc_stats.arena_chunks++;
+		arena_next = ptr;
+		arena_end = ptr + (FRAME_SIZE << order);
+	}
+	ptr = arena_next;
+	arena_next += size;
+	kmalloc_stats.arena_bytes += size;
+	restore_flags(flags);
+	memset(ptr, 0, size);
+	return ptr;
+}
@@ -0,0 +1,57 @@
+/* kmalloc.h - kernel heap: size-class slab caches over the frame allocator
+ */
+
+#ifndef KMALLOC_H
+#define KMALLOC_H
+
+#include "types.h"
+#include "frame.h"
+
+/* size classes 16, 32, ..., 1024 bytes; larger requests take whole frames */
+#define KMALLOC_MIN_SHIFT		4
+#define KMALLOC_CLASSES			7
+#define KMALLOC_MAX_SIZE		(1 << (KMALLOC_MIN_SHIFT + KMALLOC_CLASSES - 1))
+#define KMALLOC_ALIGN			16
+#define SLAB_HDR_SIZE			32			/* slab header at the start of each slab frame */
+#define BIG_HDR_SIZE			16			/* header in front of a whole-frame allocation */
+#define SLAB_MAGIC				0x51AB
+#define BIG_MAGIC				0xB16B
+#define KBOOT_CHUNK_ORDER		2			/* boot arena grows 16KB at a time */
+
+/* per size class counters */
+typedef struct kmalloc_class_stats_t_struct
+{
+	uint32_t obj_size;
+	uint32_t inuse;				// objects handed out right now
+	uint32_t allocs;
+	uint32_t frees;
+	uint32_t slabs;				// frames held by this class
+}kmalloc_class_stats_t;
+
+/* heap counters */
+typedef struct kmalloc_stats_t_struct
+{
+	uint32_t arena_bytes;		// boot arena bytes handed out
+	uint32_t arena_chunks;		// frame blocks taken by the boot arena
+	uint32_t big_allocs;
+	uint32_t big_frees;
+	uint32_t big_frames;		// frames held by whole-frame allocations
+	uint32_t failures;
+	uint32_t bad_frees;
+	kmalloc_class_stats_t classes[KMALLOC_CLASSES];
+}kmalloc_stats_t;
+
+extern kmalloc_stats_t kmalloc_stats;
+
+/* Set up the size classes; the frame allocator must be ready */
+void kmalloc_init();
+/* Allocate size bytes, 16-byte aligned; NULL if out of memory */
+void* kmalloc(uint32_t size);
+/* Allocate size zeroed bytes */
+void* kzalloc(uint32_t size);
+/* Free memory from kmalloc/kzalloc; NULL is ignored */
+void kfree(void* ptr);
+/* Permanent allocation for structures that live until shutdown */
+void* kboot_alloc(uint32_t size);
+
+#endif
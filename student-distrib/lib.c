@@ -5,21 +5,43 @@
 #include "lib.h"
 #include "keyboard.h"
 #include "filesys.h"
+#include "serial.h"
+#include "sche.h"
 //#define VIDEO 0xB8000
 #define NUM_COLS 80
 #define NUM_ROWS 25
 #define ATTRIB 0x7
 
+/*
+ * Every terminal draws into its own VGA_REGION_SIZE part of the vga text
+ * window (video_buf_addr), hidden or not; showing a terminal is only a crtc
+ * start address change. The state of the console being drawn on lives in
+ * the variables below and is swapped with consoles[] by console_select().
+ */
 static int screen_x;
 static int screen_y;
-static char* video_mem = (char *)VIDEO;
+static char* video_mem = (char *)VIDEO;	// top left of the screen, moves down its region as it scrolls
 static uint32_t fs_start_addr;
 
+static uint32_t enter_trackers[TERMINAL_NUM][NUM_ROWS];
+uint32_t* enter_tracker = enter_trackers[0];
 
-uint32_t enter_tracker[NUM_ROWS];
-
-extern volatile uint8_t keyboard_buffer[BUF_SIZE];
-extern volatile uint32_t kb_buffer_position;
+/* saved state of the consoles not selected */
+typedef struct console_struct
+{
+	char* video_mem;
+	int screen_x;
+	int screen_y;
+}console_t;
+static console_t consoles[TERMINAL_NUM];
+static int32_t con_term;			// console the variables above belong to
+static int32_t shown_term;			// console on the screen
+static uint32_t vga_viewing;		// the screen shows a scrollback view, not shown_term
+static uint32_t vga_pinned[TERMINAL_NUM];	// processes with a vidmap page of the screen: keep it at its region start
+volatile int32_t console_echo;		// keyboard echo: draw on the shown console, not the writer's
+
+extern uint8_t* keyboard_buffer;
+extern volatile uint8_t kb_buffer_position;
 extern volatile int32_t  enter_flag;
 extern volatile uint32_t cross_mode;
 uint8_t volatile rtc_flag;
@@ -40,40 +62,241 @@ void keyboard_buffer_reset(){
 	return;
 }
 
+/*
+ *	console_select(int32_t term)
+ *	Input: term -- terminal whose console to draw on
+ *	Function: save the selected console's state and load term's
+ */
+static void console_select(int32_t term)
+{
+	if(term == con_term){
+		return;
+	}
+	consoles[con_term].video_mem = video_mem;
+	consoles[con_term].screen_x = screen_x;
+	consoles[con_term].screen_y = screen_y;
+	con_term = term;
+	video_mem = consoles[term].video_mem;
+	screen_x = consoles[term].screen_x;
+	screen_y = consoles[term].screen_y;
+	enter_tracker = enter_trackers[term];
+}
+
+/*
+ *	console_target()
+ *	Input: None
+ *	Function: select the console output goes to: the terminal of the
+ *	running process, or the shown one for keyboard echo
+ */
+static void console_target()
+{
+	console_select(console_echo ? shown_term : sched_terminal);
+}
+
+/*
+ *	console_on_screen()
+ *	Input: None
+ *	Function: return whether the selected console is what the vga shows,
+ *	i.e. whether the crtc should follow it
+ */
+static int console_on_screen()
+{
+	return con_term == shown_term && !vga_viewing;
+}
+
+/*
+ *	console_init()
+ *	Input: None
+ *	Function: give every terminal a blank screen at the start of its vga
+ *	region; the kernel's boot output stays on terminal 1's
+ */
+void console_init()
+{
+	int32_t i, j;
+
+	for(i = 1; i < TERMINAL_NUM; i++){
+		consoles[i].video_mem = (char *)video_buf_addr[i];
+		consoles[i].screen_x = 0;
+		consoles[i].screen_y = 0;
+		for(j = 0; j < NUM_ROWS*NUM_COLS; j++){
+			((uint16_t *)consoles[i].video_mem)[j] = (ATTRIB << EIGHT) | ' ';
+		}
+	}
+}
+
+/*
+ *	vga_crtc_start(const void* screen)
+ *	Input: screen -- top left character to show, in the vga window
+ *	Function: point the crtc start address at it
+ */
+static void vga_crtc_start(const void* screen)
+{
+	uint16_t start = ((uint32_t)screen - VIDEO) >> 1;	// in characters
+	outb(VGA_START_HIGH, CURGGMF1);
+	outb((uint8_t)((start>>EIGHT)&ENENEN), THEFOURTH);
+	outb(VGA_START_LOW, CURGGMF1);
+	outb((uint8_t)(start&ENENEN), THEFOURTH);
+}
+
+/*
+ *	vga_crtc_cursor(uint16_t position)
+ *	Input: position -- characters from the start of the vga window
+ *	Function: move the blinking cursor
+ */
+static void vga_crtc_cursor(uint16_t position)
+{
+    // cursor LOW port to vga INDEX register
+    outb(CURPORT1, CURGGMF1);
+    outb((uint8_t)(position&ENENEN), THEFOURTH);
+    // cursor HIGH port to vga INDEX register
+    outb(THEFIFTH, CURGGMF1);
+    outb((uint8_t)((position>>EIGHT)&ENENEN), THEFOURTH);
+}
+
+/*
+ *	vga_set_start()
+ *	Input: None
+ *	Function: show the selected console from video_mem, if it is the one
+ *	on screen
+ */
+static void vga_set_start()
+{
+	if(console_on_screen()){
+		vga_crtc_start(video_mem);
+	}
+}
+
+/*
+ *	console_show(int32_t term)
+ *	Input: term -- terminal to put on the screen
+ *	Function: show term's console and cursor; its text is already in the
+ *	vga, so nothing is copied
+ */
+void console_show(int32_t term)
+{
+	shown_term = term;
+	console_select(term);
+	vga_set_start();
+	update_cursor(screen_y, screen_x);
+}
+
+/*
+ *	vga_home(int32_t term)
+ *	Input: term -- terminal
+ *	Function: move term's screen contents to the start of its vga region
+ *	and show it from there, for code that expects the screen at a page
+ *	start (vidmap). Returns that page.
+ */
+uint32_t vga_home(int32_t term)
+{
+	console_select(term);
+	if(video_mem != (char *)video_buf_addr[term]){
+		memmove((void *)video_buf_addr[term], video_mem, NUM_ROWS*NUM_COLS*2);
+		video_mem = (char *)video_buf_addr[term];
+		vga_set_start();
+		update_cursor(screen_y, screen_x);
+	}
+	return video_buf_addr[term];
+}
+
+/*
+ *	vga_pin(int32_t term, uint32_t pinned)
+ *	Input: term -- terminal
+ *	       pinned -- nonzero when a process of term maps the vidmap page,
+ *	                 zero when that process is gone
+ *	Function: a vidmap page is page granular and cannot follow the screen
+ *	down the region, so while any process holds a pin term scrolls by
+ *	moving its rows up in place, with the screen kept at the start of its
+ *	region (vga_home). Pins are counted: a parent and a child can both
+ *	have the page.
+ */
+void vga_pin(int32_t term, uint32_t pinned)
+{
+	if(pinned){
+		if(vga_pinned[term]++ == 0){
+			vga_home(term);
+		}
+	}else if(vga_pinned[term] > 0){
+		vga_pinned[term]--;
+	}
+}
+
+/*
+ *	vga_view(const void* screen)
+ *	Input: screen -- SCREEN_BYTES of text in the vga window, or NULL
+ *	Function: show screen, without a cursor, instead of the shown console,
+ *	which keeps being drawn on out of sight. NULL shows the console again.
+ */
+void vga_view(const void* screen)
+{
+	console_select(shown_term);
+	if(screen != NULL){
+		vga_viewing = 1;
+		vga_crtc_start(screen);
+		vga_crtc_cursor((((uint32_t)screen - VIDEO) >> 1) + NUM_ROWS*NUM_COLS);	// just past it: hidden
+		return;
+	}
+	vga_viewing = 0;
+	vga_set_start();
+	update_cursor(screen_y, screen_x);
+}
+
+/*
+ *	vga_screen(int32_t term)
+ *	Input: term -- terminal
+ *	Function: return the address of the character at the top left of
+ *	term's screen
+ */
+void* vga_screen(int32_t term)
+{
+	console_select(term);
+	return video_mem;
+}
+
 /* 
  *	scrolling()
  *	Input: None
  *	Function: vertical scrolling support
  * 	merged to putc; if detecting current position (80, 24)        
  * 	directly scroll screen (no need to save history)				  
+ *	The screen is a 25 row view into the console's vga region: scrolling
+ *	moves the view down one row with the crtc start address and blanks the
+ *	new bottom row. Only when the view reaches the end of the region are
+ *	the 24 kept rows copied back to its start. A console with a vidmap page
+ *	(vga_pin) stays at its region start and moves its rows up instead.
  */
 void scrolling(){
-	// copy all video memory upwards on row
-	//printf("entered scrolling");
-
-	uint8_t row_index;
-	uint8_t col_index;
+	uint32_t col_index;
+	uint16_t* last_row;
 
 	//initialize row enter indicator
 	uint8_t first_row_enter_indicator = 0;	// we assume no enter in first row
 
-	for(row_index = 0; row_index < NUM_ROWS-1; row_index++){
-		for(col_index = 0; col_index < NUM_COLS; col_index++){
-			*(uint8_t *)(video_mem + ((NUM_COLS * row_index + (col_index)) << 1)) = 
-			*(uint8_t *)(video_mem + ((NUM_COLS * (row_index+1) + col_index) << 1));
-		}
+	// the top row goes to the terminal's scrollback
+	terminal_history_push(con_term, (uint16_t *)video_mem);
+
+	if(vga_pinned[con_term]){
+		// the vidmap page is at the region start: scroll in place
+		memmove(video_mem, video_mem + NUM_COLS*2, (NUM_ROWS-1)*NUM_COLS*2);
+	}else if(video_mem + (NUM_ROWS+1)*NUM_COLS*2 > (char *)(video_buf_addr[con_term] + VGA_REGION_SIZE)){
+		memcpy((void *)video_buf_addr[con_term], video_mem + NUM_COLS*2, (NUM_ROWS-1)*NUM_COLS*2);
+		video_mem = (char *)video_buf_addr[con_term];
+	}else{
+		video_mem += NUM_COLS*2;
 	}
 
-	row_index = NUM_ROWS-1;
 	// clear last row
+	last_row = (uint16_t *)video_mem + (NUM_ROWS-1)*NUM_COLS;
 	for(col_index = 0; col_index < NUM_COLS; col_index++){
-		*(uint8_t *)(video_mem + ((NUM_COLS * row_index + (col_index)) << 1)) = ' ';
+		last_row[col_index] = (ATTRIB << EIGHT) | ' ';
 	}
+	vga_set_start();
 
 	/* Note: scrolling also needs to handle the line buffer and the enter_tracker
 	 * properly since we "discard" the data: special feature
+	 * (the line buffer is the shown terminal's)
 	 */
-	if(enter_flag == -1){
+	if(enter_flag == -1 && con_term == shown_term){
 
 		uint8_t index;
 		
@@ -135,6 +358,10 @@ void scrolling(){
  */
 void backspace()
 {
+	console_target();
+	if(console_sink & CONSOLE_SERIAL){
+		serial_write((const uint8_t*)"\b \b", 3);		// erase the echoed char on the remote terminal
+	}
 	if(screen_y==0){
 		// first row
 		if(screen_x==0)
@@ -183,19 +410,27 @@ void backspace()
  */
 void reset()
 {
+	console_target();
+	// back to the start of the console's vga region
+	video_mem = (char *)video_buf_addr[con_term];
+	vga_set_start();
 	clear();
 	screen_x = 0;
 	screen_y = 0;
 	uint8_t i;
-	//clear the keyboard buffer
+	//clear the line being typed on this terminal; keyboard_buffer points at
+	//the shown one's, whose length lives in kb_buffer_position
 	for(i = 0; i < BUF_SIZE; i++){
-		keyboard_buffer[i] = 0;
+		terminal_array[con_term].keyboard_buffer[i] = 0;
+	}
+	terminal_array[con_term].kb_position = 0;
+	if(con_term == shown_term){
+		kb_buffer_position = 0;
 	}
 	//clear the enter tracker
 	for(i = 0; i < NUM_ROWS; i++){
 		enter_tracker[i] = 0;
 	}
-	kb_buffer_position = 0;
 	//shell use
 	//puts("3910S>");
 	// need to update blinking cursor position to current screen_x and screen_y
@@ -209,14 +444,12 @@ void reset()
   */
  void update_cursor(uint16_t row, uint16_t col)
  {
- 	// update curspr pos
-    uint16_t position=(row * NUM_COLS) + col;
-    // cursor LOW port to vga INDEX register
-    outb(CURPORT1, CURGGMF1);
-    outb((uint8_t)(position&ENENEN), THEFOURTH);
-    // cursor HIGH port to vga INDEX register
-    outb(THEFIFTH, CURGGMF1);
-    outb((uint8_t)((position>>EIGHT)&ENENEN), THEFOURTH);
+ 	if(!console_on_screen()){
+ 		return;		// a hidden console keeps its cursor in screen_x/screen_y
+ 	}
+ 	// update curspr pos; the crtc counts from the window start, not the screen
+    uint16_t position=(((uint32_t)video_mem - VIDEO) >> 1) + (row * NUM_COLS) + col;
+    vga_crtc_cursor(position);
  }
 
 
@@ -246,6 +479,7 @@ void
 clear(void)
 {
     int32_t i;
+    console_target();
     for(i=0; i<NUM_ROWS*NUM_COLS; i++) {
         *(uint8_t *)(video_mem + (i << 1)) = ' ';
         *(uint8_t *)(video_mem + (i << 1) + 1) = ATTRIB;
@@ -400,6 +634,63 @@ puts(int8_t* s)
 	return index;
 }
 
+/*
+ *  vga_newline()
+ *	Input: None
+ *	Function: end the current row: remember where the enter was and move
+ *	to the start of the next row, scrolling on the last one
+ */
+static void vga_newline()
+{
+	enter_tracker[screen_y] = screen_x + OFFSET;
+	// normal mode last line enter handle
+	if(screen_y == NUM_ROWS-1){
+		scrolling();
+	}else{
+		screen_y++;
+	}
+	screen_x = 0;
+}
+
+/*
+ *  vga_write(const uint8_t* buf, int32_t nbytes)
+ *	Input: buf, nbytes -- characters to draw
+ *	Function: draw them at the text position without touching the cursor.
+ *	'\n' and '\r' end the row; everything between them is cut into runs
+ *	that fit in the current row and stored as char+attribute words.
+ */
+static void vga_write(const uint8_t* buf, int32_t nbytes)
+{
+	int32_t i, run;
+	uint16_t* cell;
+
+	i = 0;
+	while(i < nbytes){
+		if(buf[i] == '\n' || buf[i] == '\r'){
+			vga_newline();
+			i++;
+			continue;
+		}
+		// longest run of printable characters left in this row
+		cell = (uint16_t *)video_mem + NUM_COLS*screen_y + screen_x;
+		for(run = 0; i < nbytes && screen_x + run < NUM_COLS; run++, i++){
+			if(buf[i] == '\n' || buf[i] == '\r')
+				break;
+			cell[run] = (ATTRIB << EIGHT) | buf[i];
+		}
+		screen_x += run;
+		// a full row wraps to the next one, scrolling on the last one
+		if(screen_x == NUM_COLS){
+			if(screen_y < NUM_ROWS-1){
+				screen_y++;
+			}else{
+				scrolling();
+			}
+			screen_x = 0;
+		}
+	}
+}
+
 /*
 * void putc(uint8_t c);    25 * 80 console
 *   Inputs: uint_8* c = character to print
@@ -411,43 +702,45 @@ puts(int8_t* s)
 void
 putc(uint8_t c)
 {
-	//print next row
-    if(c == '\n' || c == '\r') {
-    	enter_tracker[screen_y] = screen_x + OFFSET;
-    	// normal mode last line enter handle
-    	if(screen_y==NUM_ROWS-1){
-    		scrolling();
-   			// set screen_x, screen_y
-			screen_x = 0;
-    	}else{
-        	screen_y++;
-        	screen_x=0;
-        }
-    } else {
-    	if(screen_x < NUM_COLS-1){	// keep writing in one row
-        	*(uint8_t *)(video_mem + ((NUM_COLS*screen_y + screen_x) << 1)) = c;
-        	*(uint8_t *)(video_mem + ((NUM_COLS*screen_y + screen_x) << 1) + 1) = ATTRIB;
-        	screen_x++;
-    	}else{
-    		// cursor should start new line; prepare next char
-    		if(screen_y < NUM_ROWS-1){	//keepy writing in one row
-    			*(uint8_t *)(video_mem + ((NUM_COLS*screen_y + screen_x) << 1)) = c;
-    			*(uint8_t *)(video_mem + ((NUM_COLS*screen_y + screen_x) << 1) + 1) = ATTRIB;
-    			screen_x = 0;
-    			screen_y++;
-    		}else{
-    			// need to scroll first
-    			scrolling();
-    			screen_y--;
-    			*(uint8_t *)(video_mem + ((NUM_COLS*screen_y + screen_x) << 1)) = c;
-    			*(uint8_t *)(video_mem + ((NUM_COLS*screen_y + screen_x) << 1) + 1) = ATTRIB;
-   				// set screen_x, screen_y
-   				screen_y++;
-				screen_x = 0;
-    		}
-    	}
-    } 
-    //move the cursor to current putc position
+	// console sinks: the uart gets a copy, vga may be switched off
+	if(console_sink & CONSOLE_SERIAL){
+		serial_putc(c);
+	}
+	if(!(console_sink & CONSOLE_VGA)){
+		return;
+	}
+	console_target();
+	vga_write(&c, 1);
+	//move the cursor to current putc position
+	update_cursor(screen_y, screen_x);
+}
+
+/*
+* void putc_span(const uint8_t* buf, int32_t nbytes);
+*   Inputs: buf, nbytes = characters to print
+*   Return Value: void
+*	Function: Output a whole buffer to the console, the same as calling
+*	putc on every byte, but the text is drawn in runs and the hardware
+*	cursor (several slow crtc port writes) is moved only once at the end
+*/
+void
+putc_span(const uint8_t* buf, int32_t nbytes)
+{
+	int32_t i;
+
+	if(nbytes <= 0){
+		return;
+	}
+	if(console_sink & CONSOLE_SERIAL){
+		for(i = 0; i < nbytes; i++){
+			serial_putc(buf[i]);
+		}
+	}
+	if(!(console_sink & CONSOLE_VGA)){
+		return;
+	}
+	console_target();
+	vga_write(buf, nbytes);
 	update_cursor(screen_y, screen_x);
 }
 
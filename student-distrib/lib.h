@@ -19,6 +19,11 @@
 #define ENENEN		0xFF
 #define THEFOURTH	0x03D5
 #define THEFIFTH	0x0E		
+#define VGA_START_HIGH	0x0C	/* crtc start address registers */
+#define VGA_START_LOW	0x0D
+#define VGA_WINDOW_SIZE	0x8000	/* text memory at 0xB8000-0xBFFFF */
+#define VGA_REGION_SIZE	0x2000	/* part of it each terminal draws in */
+#define VGA_VIEW_AREA	(VIDEO + TERMINAL_NUM * VGA_REGION_SIZE)	/* last part: scrollback views */
 #define EIGHT		8
 #define TEST_V		36864
 #define MAX_X		79
@@ -27,6 +32,8 @@
 
 int32_t printf(int8_t *format, ...);
 void putc(uint8_t c);
+/* putc for a whole buffer, with one cursor update */
+void putc_span(const uint8_t* buf, int32_t nbytes);
 int32_t puts(int8_t *s);
 int8_t *itoa(uint32_t value, int8_t* buf, int32_t radix);
 int8_t *strrev(int8_t* s);
@@ -37,6 +44,21 @@ void clear(void);
 void update_cursor(uint16_t row, uint16_t col);
 /* Scroll the video memory down by one row */
 void scrolling();
+/* Blank the consoles of the terminals not booted yet */
+void console_init();
+/* Put a terminal's console on the screen */
+void console_show(int32_t term);
+/* Move a terminal's screen to the start of its vga region; returns it */
+uint32_t vga_home(int32_t term);
+/* Keep a terminal's screen at its region start while a vidmap page shows it */
+void vga_pin(int32_t term, uint32_t pinned);
+/* Show other text from the vga window instead of the console, NULL to go back */
+void vga_view(const void* screen);
+/* Address of the top left character of a terminal's screen */
+void* vga_screen(int32_t term);
+
+/* set while the keyboard echoes: output goes to the shown terminal */
+extern volatile int32_t console_echo;
 /* Clear the keyboard buffer and set position to 0 */
 void keyboard_buffer_reset();
  /* Delete one character from console */
@@ -124,6 +146,17 @@ static inline uint32_t inl(port)
 	return val;
 }
 
+/* Reads the 64-bit time-stamp counter */
+static inline uint64_t rdtsc(void)
+{
+	uint64_t val;
+	asm volatile("rdtsc"
+			: "=A"(val)
+			:
+			: "memory" );
+	return val;
+}
+
 /* Writes a byte to a port */
 #define outb(data, port)                \
 do {                                    \
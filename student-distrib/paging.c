@@ -6,6 +6,15 @@
 uint32_t page_dir_addr;
 uint32_t page_tab_addr;
 
+/* program image load and fault counters */
+paging_stats_t paging_stats;
+/* tlb maintenance counters */
+tlb_stats_t tlb_stats;
+/* page tables behind the vidmap PDEs, one per terminal; only entry 0 is used */
+uint32_t vidmap_tab[VIDMAP_TABLES][PTE_SIZE] __attribute__((aligned(PGE_SIZE)));
+/* page table behind every process's time page PDE; only entry 0 is used */
+uint32_t time_tab[PTE_SIZE] __attribute__((aligned(PGE_SIZE)));
+
 /* init_paging
  *   DESCRIPTION: Set page directory and page table entries
  *   INPUTS: none
@@ -32,14 +41,18 @@ void init_paging()
 	page_dir_addr = (uint32_t)(&page_dir[FIRST_ENTRY]);
 	page_tab_addr = (uint32_t)(&page_tab[FIRST_ENTRY]);
 
-	/* Set video memory table entry */
-	video_addr = VIDEO;
+	/* Set video memory table entries: the whole text window */
+	for(i = 0; i < VIDEO_WINDOW_PAGES; i++)
+	{
+		video_addr = VIDEO + i * PGE_SIZE;
 
-	/* 12 - Skip the 12-bit offset */
-	video_addr >>= 12; 
-	page_tab[video_addr] |= SET_VIDEO_MEM;
-	page_tab[video_addr] |= SET_RW_PRESENT;
-	page_tab[video_addr] |= VIDEO;
+		/* 12 - Skip the 12-bit offset */
+		video_addr >>= 12; 
+		page_tab[video_addr] |= SET_VIDEO_MEM;
+		page_tab[video_addr] |= SET_RW_PRESENT;
+		page_tab[video_addr] |= VIDEO + i * PGE_SIZE;
+		page_tab[video_addr] |= PAGE_GLOBAL;
+	}
 	
 	/* Set the first page directory entry to be present */
 	temp = page_tab_addr;
@@ -49,16 +62,27 @@ void init_paging()
 	/* Set 4MB - 8MB, the KERNEL entry */
 	page_dir[SECOND_ENTRY] |= PAGE_4MB; 
 	page_dir[SECOND_ENTRY] |= SET_RW_PRESENT; 
+	page_dir[SECOND_ENTRY] |= PAGE_GLOBAL; 
 	temp = KERNEL_ADDR;
 	temp &= BITS20_MASK;
 	page_dir[SECOND_ENTRY] |= temp; 
 
+	/* Map the frame allocator's memory 1:1, kernel only */
+	for(i = PHYS_MAP_FIRST_PDE; i <= PHYS_MAP_LAST_PDE; i++)
+	{
+		page_dir[i] = (i << PDE_SHIFT) | PAGE_4MB | SET_RW_PRESENT | PAGE_GLOBAL;
+	}
+
 	/* Enable paging */
 	enable_paging();
 	return;
 }
 /* enable_paging
- *   DESCRIPTION: Assembly to enable paging 
+ *   DESCRIPTION: Assembly to enable paging, once at boot. Turns on 4MB
+ *                pages and global pages (CR4.PSE/PGE), so kernel and video
+ *                entries survive later cr3 loads. CR0.WP is set as well so
+ *                that kernel writes to read-only user pages fault like user
+ *                writes do (needed for copy-on-write program pages).
  *   INPUTS: none
  *   OUTPUTS: none
  *   RETURN VALUE: none
@@ -70,14 +94,60 @@ void enable_paging()
 	"movl page_dir_addr, %%eax        ;"
 	"movl %%eax, %%cr3                ;"
 	"movl %%cr4, %%eax                ;"
-	"orl $0x00000010, %%eax           ;"
+	"orl $0x00000090, %%eax           ;"
 	"movl %%eax, %%cr4                ;"
 	"movl %%cr0, %%eax                ;"
-	"orl $0x80000000, %%eax 	      ;"
+	"orl $0x80010000, %%eax 	      ;"
 	"movl %%eax, %%cr0                 "
 	: : : "eax");
 }
 
+/* load_page_dir
+ *   DESCRIPTION: switch address space; only non-global tlb entries go
+ *   INPUTS: dir -- page directory (kernel address == physical)
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+void load_page_dir(uint32_t* dir)
+{
+	tlb_stats.cr3_loads++;
+	asm volatile("movl %0, %%cr3" : : "r"(dir) : "memory");
+}
+
+/* paging_alloc_dir
+ *   DESCRIPTION: build a page directory for a process: the kernel part is
+ *                copied from the boot directory, the user page goes
+ *                through the given table, the time page through time_tab,
+ *                everything else is absent
+ *   INPUTS: user_table -- 4KB page table of the 128MB user page
+ *   OUTPUTS: none
+ *   RETURN VALUE: the directory, NULL if out of memory
+ */
+uint32_t* paging_alloc_dir(uint32_t* user_table)
+{
+	uint32_t* dir = (uint32_t*)frame_alloc(0);
+	if(dir == NULL)
+		return NULL;
+	memcpy(dir, page_dir, (PHYS_MAP_LAST_PDE + 1) * sizeof(uint32_t));
+	memset(dir + PHYS_MAP_LAST_PDE + 1, 0, (PDE_SIZE - PHYS_MAP_LAST_PDE - 1) * sizeof(uint32_t));
+	dir[USER_PDE_INDEX] = ((uint32_t)user_table & BITS20_MASK) | SET_RW_PRESENT | USER;
+	dir[TIME_PDE_INDEX] = ((uint32_t)time_tab & BITS20_MASK) | SET_RW_PRESENT | USER;
+	return dir;
+}
+
+/* paging_free_dir
+ *   DESCRIPTION: free a process page directory; the user page table it
+ *                points to is freed separately
+ *   INPUTS: dir -- directory from paging_alloc_dir
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+void paging_free_dir(uint32_t* dir)
+{
+	if(dir != NULL)
+		frame_free((uint32_t)dir, 0);
+}
+
 /* flush_tlb
  *   DESCRIPTION: invalidate tlbs
  *   INPUTS: none
@@ -87,12 +157,183 @@ void enable_paging()
 void flush_tlb()
 {
 	//printf("tlb flushed!\n");
+	tlb_stats.full_flushes++;
 	asm volatile(
 	"movl %%cr3, %%eax;"
 	"movl %%eax, %%cr3"
 	: : : "eax");
 }
 
+/* invalidate_page
+ *   DESCRIPTION: drop the tlb entry of a single virtual page
+ *   INPUTS: vaddr -- any address inside the page
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+void invalidate_page(uint32_t vaddr)
+{
+	tlb_stats.invlpgs++;
+	asm volatile("invlpg (%0)" : : "r"(vaddr) : "memory");
+}
+
+/* paging_set_pde
+ *   DESCRIPTION: update one page directory entry; when the directory is
+ *                the one in cr3, invlpg drops the cached translation (and
+ *                paging-structure cache) for that address
+ *   INPUTS: dir -- page directory
+ *           vaddr -- any address covered by the entry
+ *           entry -- new entry
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+void paging_set_pde(uint32_t* dir, uint32_t vaddr, uint32_t entry)
+{
+	uint32_t cr3;
+	dir[vaddr >> PDE_SHIFT] = entry;
+	asm volatile("movl %%cr3, %0" : "=r"(cr3));
+	if((cr3 & BITS20_MASK) == (uint32_t)dir)
+		invalidate_page(vaddr);
+}
+
+/* paging_set_pte
+ *   DESCRIPTION: update one page table entry and invalidate that page
+ *   INPUTS: table -- page table covering vaddr
+ *           vaddr -- address of the page
+ *           entry -- new entry
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+void paging_set_pte(uint32_t* table, uint32_t vaddr, uint32_t entry)
+{
+	table[(vaddr >> PAGE_SHIFT) & (PTE_SIZE - 1)] = entry;
+	invalidate_page(vaddr);
+}
+
+/* paging_map_user_video
+ *   DESCRIPTION: point a terminal's vidmap page at a physical video page.
+ *                The vidmap PDEs of a terminal's processes share its
+ *                vidmap_tab, and other address spaces drop their
+ *                non-global entries on the next cr3 load, so a single
+ *                invlpg is enough.
+ *   INPUTS: terminal -- terminal whose table to set
+ *           phys -- 4KB aligned video page
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+void paging_map_user_video(uint32_t terminal, uint32_t phys)
+{
+	paging_set_pte(vidmap_tab[terminal], VIDMAP_VIRT, (phys & BITS20_MASK) | SET_RW_PRESENT | USER);
+	tlb_stats.video_remaps++;
+}
+
+/* paging_map_time_page
+ *   DESCRIPTION: map the clock's page at TIME_PAGE_VIRT, user readable but
+ *                not writable. The mapping is the same in every address
+ *                space, so it is global. Once at boot.
+ *   INPUTS: phys -- 4KB aligned kernel page
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+void paging_map_time_page(uint32_t phys)
+{
+	time_tab[0] = (phys & BITS20_MASK) | PAGE_PRESENT | USER | PAGE_GLOBAL;
+}
+
+/* paging_alloc_user_table
+ *   DESCRIPTION: get a frame for a user page table with nothing mapped
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: the table (kernel address == physical), NULL if out of memory
+ */
+uint32_t* paging_alloc_user_table()
+{
+	uint32_t* table = (uint32_t*)frame_alloc(0);
+	if(table != NULL)
+		memset(table, 0, PGE_SIZE);
+	return table;
+}
+
+/* paging_free_user_table
+ *   DESCRIPTION: release every frame owned by a user page table and the
+ *                table itself; pages shared with the fs image are skipped
+ *   INPUTS: table -- table from paging_alloc_user_table
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ */
+void paging_free_user_table(uint32_t* table)
+{
+	int i;
+	if(table == NULL)
+		return;
+	for(i = 0; i < PTE_SIZE; i++)
+	{
+		if((table[i] & PAGE_PRESENT) && !(table[i] & PTE_COW))
+			frame_free(table[i] & BITS20_MASK, 0);
+	}
+	frame_free((uint32_t)table, 0);
+}
+
+/* paging_map_user_page
+ *   DESCRIPTION: point one 4KB page of the user page at a physical page
+ *   INPUTS: table -- page table for this task
+ *           vaddr -- user virtual address of the page
+ *           phys -- 4KB aligned physical address
+ *           flags -- low 12 bits of the entry
+ *   OUTPUTS: entry updated; caller reloads cr3 or invalidates the page
+ *   RETURN VALUE: none
+ */
+void paging_map_user_page(uint32_t* table, uint32_t vaddr, uint32_t phys, uint32_t flags)
+{
+	table[((vaddr - USER_VIRT_BASE) >> PAGE_SHIFT) & (PTE_SIZE - 1)] = (phys & BITS20_MASK) | (flags & ~BITS20_MASK);
+}
+
+/* paging_alloc_user_page
+ *   DESCRIPTION: back one user page with a freshly zeroed private frame
+ *   INPUTS: table -- page table for this task
+ *           vaddr -- user virtual address of the page
+ *   OUTPUTS: entry set to user R/W present; caller invalidates the page
+ *   RETURN VALUE: physical address of the frame, 0 if out of memory
+ */
+uint32_t paging_alloc_user_page(uint32_t* table, uint32_t vaddr)
+{
+	uint32_t frame = frame_alloc(0);
+	if(frame == 0)
+		return 0;
+	memset((void*)frame, 0, PGE_SIZE);
+	paging_map_user_page(table, vaddr, frame, SET_RW_PRESENT | USER);
+	return frame;
+}
 
+/* paging_cow_fault
+ *   DESCRIPTION: handle a write to a read-only page that is shared with the
+ *                filesystem image: give the task its own copy of the page in
+ *                a new frame and make it writable
+ *   INPUTS: table -- user page table of the faulting task
+ *           fault_addr -- cr2
+ *           error_code -- page fault error code pushed by the cpu
+ *   OUTPUTS: page table entry switched to the private copy
+ *   RETURN VALUE: 0 if the fault was resolved, -1 if it is a real fault
+ */
+int32_t paging_cow_fault(uint32_t* table, uint32_t fault_addr, uint32_t error_code)
+{
+	uint32_t index, src, frame;
 
+	/* only writes to present pages inside the 4KB-mapped user page */
+	if((error_code & (PF_PRESENT | PF_WRITE)) != (PF_PRESENT | PF_WRITE))
+		return -1;
+	if(fault_addr < USER_VIRT_BASE || fault_addr >= USER_VIRT_BASE + USER_PAGE_SPAN)
+		return -1;
+	index = (fault_addr - USER_VIRT_BASE) >> PAGE_SHIFT;
+	if(!(table[index] & PTE_COW))
+		return -1;
 
+	/* both frames are reachable through the kernel's 1:1 mapping */
+	frame = frame_alloc(0);
+	if(frame == 0)
+		return -1;
+	src = table[index] & BITS20_MASK;
+	memcpy((void*)frame, (void*)src, PGE_SIZE);
+	table[index] = frame | SET_RW_PRESENT | USER;
+	invalidate_page(fault_addr & BITS20_MASK);
+	return 0;
+}
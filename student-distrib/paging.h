@@ -6,6 +6,7 @@
 
 #include "types.h"
 #include "lib.h"
+#include "frame.h"
 
 /* Decimal constants */
 #define FIRST_ENTRY  0
@@ -18,12 +19,71 @@
 #define PAGE_4MB				0x80
 #define VIDEO 					0x0B8000
 #define VIDEO_ADDR_MASK			0x3FF000
+#define VIDEO_WINDOW_PAGES		8			/* 32KB text window the console scrolls through */
 #define KERNEL_ADDR				0x400000   
 #define BITS20_MASK				0xFFFFF000
 #define SET_RW_NOT_PRESENT		0x00000002
 #define SET_RW_PRESENT 			0x00000003
 #define USER					0x04 
 #define SET_VIDEO_MEM			0x00000007
+#define PAGE_PRESENT			0x00000001
+#define PAGE_GLOBAL				0x00000100		/* kept in the tlb across cr3 loads */
+#define PTE_COW					0x00000200		/* available bit: read-only page shared with the fs image */
+#define PTE_DEMAND				0x00000400		/* available bit: not-present page loaded from the program file */
+
+/* user program page: 128MB virtual, now split into 4KB pages */
+#define USER_PDE_INDEX			32
+#define USER_VIRT_BASE			0x08000000
+#define USER_PAGE_SPAN			0x00400000
+#define PAGE_SHIFT				12
+#define PDE_SHIFT				22
+
+/* read-only clock page mapped into every process: 132MB virtual */
+#define TIME_PDE_INDEX			33
+#define TIME_PAGE_VIRT			0x08400000
+
+/* user video page set up by vidmap: 136MB virtual */
+#define VIDMAP_PDE_INDEX		34
+#define VIDMAP_VIRT				0x08800000
+#define VIDMAP_TABLES			3			/* one per terminal */
+
+/* physical memory from 8MB up to 128MB, mapped 1:1 for the kernel only */
+#define PHYS_MAP_FIRST_PDE		2
+#define PHYS_MAP_LAST_PDE		31
+
+/* page fault error code bits */
+#define PF_PRESENT				0x1
+#define PF_WRITE				0x2
+
+/* program image paging statistics */
+typedef struct paging_stats_t_struct
+{
+	uint32_t exec_loads;		// images set up by execute()
+	uint32_t demand_faults;		// image pages brought in on first touch
+	uint32_t cow_faults;		// shared image pages copied on first write
+	uint32_t pages_mapped;		// image pages mapped straight from the fs image
+	uint32_t pages_copied;		// image pages copied into task memory
+	uint32_t zero_fills;		// stack/bss pages allocated on first touch
+	uint64_t load_cycles;		// tsc cycles spent in execute() loading images
+	uint64_t fault_cycles;		// tsc cycles spent resolving image page faults
+}paging_stats_t;
+
+extern paging_stats_t paging_stats;
+
+/* tlb maintenance counters */
+typedef struct tlb_stats_t_struct
+{
+	uint32_t cr3_loads;			// address space switches
+	uint32_t full_flushes;		// flush_tlb() calls
+	uint32_t invlpgs;			// single page invalidations
+	uint32_t video_remaps;		// user video page remaps (vidmap, terminal switch)
+}tlb_stats_t;
+
+extern tlb_stats_t tlb_stats;
+/* page tables behind the vidmap PDEs, one per terminal */
+extern uint32_t vidmap_tab[VIDMAP_TABLES][PTE_SIZE];
+/* page table behind every process's time page PDE */
+extern uint32_t time_tab[PTE_SIZE];
 
 /* page directory and page table entries */
 uint32_t page_dir[PDE_SIZE] __attribute__((aligned(PGE_SIZE)));
@@ -32,10 +92,37 @@ uint32_t page_tab[PTE_SIZE] __attribute__((aligned(PGE_SIZE)));
 /* Set page directory and page table entries */
 void init_paging();
 
-/* Assembly to enable paging */
+/* Assembly to enable paging, once at boot */
 void enable_paging();
+/* Switch to another page directory */
+void load_page_dir(uint32_t* dir);
+/* Build a process page directory around a user page table */
+uint32_t* paging_alloc_dir(uint32_t* user_table);
+/* Free a process page directory */
+void paging_free_dir(uint32_t* dir);
 /* Flush the tlb */
 void flush_tlb();
+/* Invalidate the tlb entry of one virtual page */
+void invalidate_page(uint32_t vaddr);
+/* Set the PDE covering vaddr, invalidating it if dir is live */
+void paging_set_pde(uint32_t* dir, uint32_t vaddr, uint32_t entry);
+/* Set the PTE for vaddr and invalidate that page */
+void paging_set_pte(uint32_t* table, uint32_t vaddr, uint32_t entry);
+/* Point a terminal's vidmap page at a physical video page */
+void paging_map_user_video(uint32_t terminal, uint32_t phys);
+/* Map the clock's page read-only at TIME_PAGE_VIRT for every process */
+void paging_map_time_page(uint32_t phys);
+
+/* Allocate an empty user page table */
+uint32_t* paging_alloc_user_table();
+/* Free a user page table and every private frame it maps */
+void paging_free_user_table(uint32_t* table);
+/* Map one 4KB user page in a user page table */
+void paging_map_user_page(uint32_t* table, uint32_t vaddr, uint32_t phys, uint32_t flags);
+/* Back one user page with a new zeroed frame */
+uint32_t paging_alloc_user_page(uint32_t* table, uint32_t vaddr);
+/* Resolve a write fault on a copy-on-write user page */
+int32_t paging_cow_fault(uint32_t* table, uint32_t fault_addr, uint32_t error_code);
 
 #endif
 
@@ -8,6 +8,32 @@
 #include "i8259.h"
 #include "sche.h"
 #include "syscall.h"
+#include "profile.h"
+
+extern volatile uint8_t curr_task_pos;
+
+pit_stats_t pit_stats;
+
+/* PIT_PERIODIC, or PIT_ONESHOT while tickless */
+static uint32_t pit_mode;
+/* count of the one-shot in flight */
+static uint32_t pit_armed;
+/* pit counts elapsed but not yet accounted as a whole tick */
+static uint32_t pit_remainder;
+
+/*
+ *  pit_program(uint8_t config, uint32_t count)
+ *	Input: config -- mode byte for the command port
+ *		   count -- reload value for channel 0
+ *	Output: None
+ *  Side effect: reprogram channel 0; counting restarts from count
+ */
+static void pit_program(uint8_t config, uint32_t count)
+{
+	outb(config, PITPORT);
+	outb(count & MASK, DATA_PORT1);	//send low 8 bits to channel 0
+	outb((count >> BITSHIFT) & MASK, DATA_PORT1); 	//send high 8 bits to channel 0
+}
 
 /*
  *  pit_init()
@@ -20,34 +46,101 @@ void pit_init()
 	//enable the pit
 	enable_irq(IRQ0);
 	//define access mode, operating mode and binary mode
-	//0x36 command to ox43 port
-	outb(CONFIG, PITPORT);
-	int divider;
 	//set interrupt frequency to 50 HZ
-	divider = OSCII_FREQ/FREQ;
-	int low_byte = divider && MASK;	//obtain low 8 bits
-	outb(low_byte, DATA_PORT1);	//send low 8 bits to channel 1
-	int high_byte = divider >> BITSHIFT;	//obtain high 8 bits
-	outb(high_byte, DATA_PORT1); 	//send high 8 bits to channel 1
+	pit_mode = PIT_PERIODIC;
+	pit_remainder = 0;
+	pit_program(CONFIG, TICK_COUNT);
 }
 
 /*
- *  _idt_pit_irq_handler()
+ *  pit_periodic()
  *	Input: None
  *	Output: None
- *  Side effect: handle the pit interrupt properly and call
- *	schedulling function
+ *  Side effect: leave tickless mode. The part of the one-shot that already
+ *	ran is kept, so the tick count does not lose time. A one-shot that has
+ *	already expired is left alone: its interrupt is pending, and the handler
+ *	counts the full one-shot and goes periodic itself. Interrupts must be
+ *	off; safe from any interrupt handler.
  */
-void _idt_pit_irq_handler(){
-	//printf("pit irqed\n");
-	// disable interrupt
-	cli();
-	//call schedulling
-	scheduling_handler();
-	// re-enable the IRQ 1
-	send_eoi(IRQ0); 
-	// re-able interrupts
-	sti();
+void pit_periodic()
+{
+	uint8_t status;
+	uint32_t left;
+
+	if(pit_mode == PIT_PERIODIC)
+		return;
+	outb(CONFIG_READBACK, PITPORT);
+	status = inb(DATA_PORT1);
+	left = inb(DATA_PORT1);
+	left |= inb(DATA_PORT1) << BITSHIFT;
+	// past terminal count the counter wraps, so the count says nothing then
+	if(status & STATUS_OUT)
+		return;
+	if(!(status & STATUS_NULL))
+		pit_remainder += pit_armed - left;
+	pit_mode = PIT_PERIODIC;
+	pit_program(CONFIG, TICK_COUNT);
 }
 
+/*
+ *  pit_oneshot(uint32_t count)
+ *	Input: count -- pit counts until the next interrupt, at most MAX_COUNT
+ *	Output: None
+ *  Side effect: stop the periodic tick. Only called from the pit interrupt,
+ *	where no part of a period is lost by reprogramming.
+ */
+void pit_oneshot(uint32_t count)
+{
+	if(count > MAX_COUNT)
+		count = MAX_COUNT;
+	pit_mode = PIT_ONESHOT;
+	pit_armed = count;
+	pit_stats.oneshots++;
+	pit_program(CONFIG_ONESHOT, count);
+}
+
+/*
+ *  uint32_t pit_elapsed_ticks()
+ *	Input: None
+ *	Output: whole ticks since the last pit interrupt
+ *  Side effect: a periodic interrupt is one tick; a one-shot covers several,
+ *	and the fraction left over is carried to the next interrupt
+ */
+static uint32_t pit_elapsed_ticks()
+{
+	uint32_t ticks;
+
+	pit_remainder += (pit_mode == PIT_ONESHOT) ? pit_armed : TICK_COUNT;
+	ticks = pit_remainder / TICK_COUNT;
+	pit_remainder -= ticks * TICK_COUNT;
+	if(ticks > 1)
+		pit_stats.saved_ticks += ticks - 1;
+	return ticks;
+}
 
+/*
+ *  _idt_pit_irq_handler(uint32_t* frame)
+ *	Input: frame -- the interrupted eip, cs and eflags as the cpu pushed them
+ *	Output: None
+ *  Side effect: handle the pit interrupt properly, sample the interrupted
+ *	code for the profiler and call schedulling function. The eoi goes out first: the scheduler may resume
+ *	another task, and this one only comes back here on a later tick.
+ *	Interrupts stay off until iret restores the interrupted EFLAGS.
+ */
+void _idt_pit_irq_handler(uint32_t* frame){
+	uint32_t ticks;
+	//printf("pit irqed\n");
+	// acknowledge the IRQ 0
+	send_eoi(IRQ0); 
+	pit_stats.irqs++;
+	ticks = pit_elapsed_ticks();
+	// a one-shot that ended is done; the scheduler re-arms or goes periodic
+	if(pit_mode == PIT_ONESHOT)
+		pit_program(CONFIG, TICK_COUNT);
+	pit_mode = PIT_PERIODIC;
+#if PROFILE_ENABLE
+	profile_sample(frame[0], frame[1], curr_task_pos, ticks);
+#endif
+	//call schedulling
+	scheduling_handler(ticks);
+}
@@ -4,6 +4,7 @@
 #ifndef	PIT_H
 #define PIT_H
 
+#include "types.h"
 
 
 //frequency used by the PIT chip
@@ -11,6 +12,15 @@
 //binary mode, square wave and lo/hibyte access mode
 //00110110 is 0x36
 #define CONFIG	0x36
+//binary mode, interrupt on terminal count (one-shot) and lo/hibyte access mode
+//00110000 is 0x30
+#define CONFIG_ONESHOT	0x30
+//read-back: latch channel 0 status and count for reading
+//11000010 is 0xC2
+#define CONFIG_READBACK	0xC2
+//read-back status bits
+#define STATUS_OUT		0x80	// output pin; goes high when a one-shot reaches terminal count
+#define STATUS_NULL		0x40	// count just written, not loaded into the counter yet
 
 //4 ports used by pit device
 #define	DATA_PORT1	0x40
@@ -23,10 +33,30 @@
 #define	MASK	0xFF
 #define	BITSHIFT	8
 #define FREQ 	50
+#define TICK_COUNT		(OSCII_FREQ / FREQ)	// pit counts in one tick
+#define MAX_COUNT		0xFFFF				// longest one-shot, about 55ms
+#define PIT_TICKLESS	1					// stop the periodic tick while nothing else is ready
+#define PIT_PERIODIC	0					// pit_mode values
+#define PIT_ONESHOT		1
+
+/* pit counters */
+typedef struct pit_stats_t_struct
+{
+	uint32_t irqs;					// pit interrupts taken
+	uint32_t oneshots;				// one-shot deadlines programmed
+	uint32_t saved_ticks;			// ticks accounted without an interrupt of their own
+	uint32_t idle_saved_ticks;		// those of them that found the cpu idle
+}pit_stats_t;
+
+extern pit_stats_t pit_stats;
 
 /* Initialize programmable interval timer */
 void pit_init();
 /* the pit interrupt handler, call scheduling helper */
-void _idt_pit_irq_handler();
+void _idt_pit_irq_handler(uint32_t* frame);
+/* Go back to the periodic tick; no-op if already periodic */
+void pit_periodic();
+/* Stop the periodic tick; the next interrupt comes after count pit counts */
+void pit_oneshot(uint32_t count);
 
 #endif
@@ -0,0 +1,213 @@
+/* profile.c - Statistical profiler: the pit interrupt samples the
+ * interrupted eip into a histogram, read back through a special file
+ */
+#include "profile.h"
+#include "lib.h"
+#include "kmalloc.h"
+#include "syscall.h"
+
+extern volatile uint8_t curr_task_pos;
+
+/* snapshot of the histogram an open profile file reads from */
+typedef struct prof_text_t_struct
+{
+	uint32_t len;
+	uint8_t text[0];
+}prof_text_t;
+
+static prof_bucket_t prof_table[PROF_BUCKETS];
+static uint32_t prof_samples;		// ticks charged, dropped ones included
+static uint32_t prof_dropped;		// ticks that found no free slot
+static uint32_t prof_used;			// slots in use
+
+/*
+ *  void profile_sample(uint32_t eip, uint32_t cs, uint32_t pid, uint32_t ticks)
+ *	Input: eip, cs -- where the pit interrupt came in
+ *		   pid -- task position running then, NO_TASK for none
+ *		   ticks -- ticks the interrupt stands for; more than 1 after a one-shot
+ *	Output: None
+ *  Side effect: add ticks to the slot of that 16-byte range. Open addressing
+ *	with a short probe; a full neighbourhood drops the sample. Called from
+ *	the pit interrupt with interrupts off.
+ */
+void profile_sample(uint32_t eip, uint32_t cs, uint32_t pid, uint32_t ticks)
+{
+	uint32_t ring = cs & RING_MASK;
+	uint32_t h, i;
+	prof_bucket_t* b;
+
+	eip &= ~((1 << PROF_SHIFT) - 1);
+	if(pid >= PROF_NO_PID)
+		pid = PROF_NO_PID;
+	prof_samples += ticks;
+	h = ((eip >> PROF_SHIFT) * 2654435761U) ^ (pid << 3) ^ ring;
+	for(i = 0; i < PROF_PROBES; i++)
+	{
+		b = &prof_table[(h + i) & (PROF_BUCKETS - 1)];
+		if(!b->used)
+		{
+			b->used = 1;
+			b->eip = eip;
+			b->ring = ring;
+			b->pid = pid;
+			b->count = ticks;
+			prof_used++;
+			return;
+		}
+		if(b->eip == eip && b->pid == pid && b->ring == ring)
+		{
+			b->count += ticks;
+			return;
+		}
+	}
+	prof_dropped += ticks;
+}
+
+/*
+ *  uint8_t* prof_put_str(uint8_t* p, const int8_t* s)
+ *  uint8_t* prof_put_dec(uint8_t* p, uint32_t v)
+ *  uint8_t* prof_put_hex(uint8_t* p, uint32_t v)
+ *	Input: p -- where to write; s/v -- what
+ *	Output: the end of the written text
+ *  Side effect: hex is 0x and 8 digits, so lines sort as text
+ */
+static uint8_t* prof_put_str(uint8_t* p, const int8_t* s)
+{
+	while(*s)
+		*p++ = *s++;
+	return p;
+}
+
+static uint8_t* prof_put_dec(uint8_t* p, uint32_t v)
+{
+	int8_t num[16];
+	return prof_put_str(p, itoa(v, num, 10));
+}
+
+static uint8_t* prof_put_hex(uint8_t* p, uint32_t v)
+{
+	int32_t shift;
+	*p++ = '0';
+	*p++ = 'x';
+	for(shift = 28; shift >= 0; shift -= 4)
+		*p++ = "0123456789abcdef"[(v >> shift) & 0xF];
+	return p;
+}
+
+/*
+ *  prof_text_t* profile_file(int32_t fd)
+ *	Input: fd -- open profile file of the running process
+ *	Output: its snapshot, NULL if it has none
+ *  Side effect: None
+ */
+static prof_text_t* profile_file(int32_t fd)
+{
+	pcb_t* pcb = get_pcb(curr_task_pos);
+	if(pcb == NULL || fd < 0 || fd >= MAXOPENFILE)
+		return NULL;
+	return (prof_text_t*)pcb->file_array[fd].private_data;
+}
+
+/*
+ * profile_open(const uint8_t* filename)
+ * Note: the histogram is copied out as text, one line per slot:
+ *   0x<eip> <ring> <pid> <ticks>
+ * after a "# profile" header line; pid is - for the idle loop
+ * return value: the snapshot, NULL if out of memory
+ */
+void* profile_open(const uint8_t* filename)
+{
+	prof_text_t* snap;
+	uint8_t* p;
+	uint32_t flags, i;
+
+	cli_and_save(flags);
+	snap = kmalloc(sizeof(prof_text_t) + PROF_HEADER_MAX + prof_used * PROF_LINE_MAX);
+	if(snap == NULL)
+	{
+		restore_flags(flags);
+		return NULL;
+	}
+	p = prof_put_str(snap->text, "# profile samples=");
+	p = prof_put_dec(p, prof_samples);
+	p = prof_put_str(p, " dropped=");
+	p = prof_put_dec(p, prof_dropped);
+	p = prof_put_str(p, " slots=");
+	p = prof_put_dec(p, prof_used);
+	p = prof_put_str(p, " bucket_bytes=");
+	p = prof_put_dec(p, 1 << PROF_SHIFT);
+	*p++ = '\n';
+	for(i = 0; i < PROF_BUCKETS; i++)
+	{
+		if(!prof_table[i].used)
+			continue;
+		p = prof_put_hex(p, prof_table[i].eip);
+		*p++ = ' ';
+		p = prof_put_dec(p, prof_table[i].ring);
+		*p++ = ' ';
+		if(prof_table[i].pid == PROF_NO_PID)
+			*p++ = '-';
+		else
+			p = prof_put_dec(p, prof_table[i].pid);
+		*p++ = ' ';
+		p = prof_put_dec(p, prof_table[i].count);
+		*p++ = '\n';
+	}
+	snap->len = p - snap->text;
+	restore_flags(flags);
+	return snap;
+}
+
+/*
+ * profile_read(int32_t fd, void* buf, int32_t nbytes)
+ * Note: reads the snapshot taken at open, like a regular file
+ * return value: bytes read, 0 at the end
+ */
+int32_t profile_read(int32_t fd, void* buf, int32_t nbytes)
+{
+	prof_text_t* snap = profile_file(fd);
+	pcb_t* pcb = get_pcb(curr_task_pos);
+	uint32_t pos;
+
+	if(snap == NULL || buf == NULL || nbytes < 0)
+		return -1;
+	pos = pcb->file_array[fd].file_pos;
+	if(pos >= snap->len)
+		return 0;
+	if((uint32_t)nbytes > snap->len - pos)
+		nbytes = snap->len - pos;
+	memcpy(buf, snap->text + pos, nbytes);
+	pcb->file_array[fd].file_pos = pos + nbytes;
+	return nbytes;
+}
+
+/*
+ * profile_write(int32_t fd, const void* buf, int32_t nbytes)
+ * Note: any write clears the histogram, to profile from a known point;
+ * this fd keeps its snapshot
+ * return value: nbytes
+ */
+int32_t profile_write(int32_t fd, const void* buf, int32_t nbytes)
+{
+	uint32_t flags;
+
+	cli_and_save(flags);
+	memset(prof_table, 0, sizeof(prof_table));
+	prof_samples = prof_dropped = prof_used = 0;
+	restore_flags(flags);
+	return nbytes;
+}
+
+/*
+ * profile_close(int32_t fd)
+ * Note: frees the fd's snapshot
+ */
+int32_t profile_close(int32_t fd)
+{
+	prof_text_t* snap = profile_file(fd);
+	if(snap == NULL)
+		return -1;
+	get_pcb(curr_task_pos)->file_array[fd].private_data = NULL;
+	kfree(snap);
+	return 0;
+}
@@ -0,0 +1,38 @@
+/* profile.h - Defines used by the pit sampling profiler
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "types.h"
+
+#define PROFILE_ENABLE		1			// sample on every pit interrupt
+#define PROFILE_NAME		"profile"	// special file the histogram is read from
+#define PROFILE_FILE_TYPE	3			// dentry type open() gives the special file
+#define PROF_BUCKETS		1024		// histogram slots, a power of 2
+#define PROF_SHIFT			4			// eips are bucketed by 16 bytes
+#define PROF_PROBES			8			// slots tried before a sample is dropped
+#define PROF_LINE_MAX		32			// "0x%08x %d %d %u\n" and then some
+#define PROF_HEADER_MAX		96
+#define PROF_NO_PID			0xFF		// sample taken with no task running
+#define RING_MASK			0x3
+
+/* one histogram slot: samples of a 16-byte code range in one process */
+typedef struct prof_bucket_t_struct
+{
+	uint32_t eip;					// first address of the range
+	uint8_t ring;					// privilege level of the interrupted code
+	uint8_t pid;					// task position, PROF_NO_PID for idle/launch
+	uint16_t used;
+	uint32_t count;					// ticks charged to the range
+}prof_bucket_t;
+
+/* Charge ticks to the code interrupted at cs:eip in task pid */
+void profile_sample(uint32_t eip, uint32_t cs, uint32_t pid, uint32_t ticks);
+/* Special file operations: open snapshots the histogram as text */
+void* profile_open(const uint8_t* filename);
+int32_t profile_read(int32_t fd, void* buf, int32_t nbytes);
+int32_t profile_write(int32_t fd, const void* buf, int32_t nbytes);
+int32_t profile_close(int32_t fd);
+
+#endif
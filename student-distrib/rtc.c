@@ -4,9 +4,33 @@
 #include "rtc.h"
 #include "lib.h"
 #include "i8259.h"
+#include "sche.h"
+#include "kmalloc.h"
+#include "syscall.h"
 
-/* flag to check whether irq enabled for rtc */
-volatile uint32_t rtc_interrupt_occured = 0;
+extern volatile uint8_t curr_task_pos;
+
+/* rtc interrupts so far */
+volatile uint32_t rtc_ticks = 0;
+/* files with a sleeping reader, and the earliest tick one of them is due */
+static rtc_file_t* rtc_pending;
+static uint32_t rtc_next_due;
+
+rtc_stats_t rtc_stats;
+
+/*
+ * rtc_file(int32_t fd)
+ * Input: fd -- file descriptor of the current process
+ * Output: the fd's rtc state, NULL if fd is not an open rtc
+ */
+static rtc_file_t* rtc_file(int32_t fd)
+{
+	pcb_t* pcb = get_pcb(curr_task_pos);
+	if(pcb == NULL || fd < 0 || fd >= MAXOPENFILE || pcb->file_array[fd].flags == 0){
+		return NULL;
+	}
+	return (rtc_file_t*)pcb->file_array[fd].private_data;
+}
 
 /*
  * rtc_init()
@@ -23,8 +47,14 @@ void rtc_init()
 	outb(RTCREGB, RTCPORT1);				// set the index again (a read will reset the index to register D)
 	outb(prev | RTCORED, RTCPORT2);			// write the previous value ORed with 0x40. This turns on bit 6 of register B
 
-	// open port for rtc
-	enable_irq(RTCIRQ8);
+	// fixed hardware rate; every open rtc divides it down
+	outb(RTCREGA, RTCPORT1);				// select register A, and disable NMI
+	prev = inb(RTCPORT2);					// read the current value of register A
+	outb(RTCREGA, RTCPORT1);				// set the index again
+	outb((prev & RTCUNUN) | RTC_HW_RATE, RTCPORT2);
+	rtc_pending = NULL;
+
+	// open port for rtc; IRQ8 itself only while some rtc is open
 	enable_irq(RTCIRQ2);
 }
 
@@ -32,8 +62,10 @@ void rtc_init()
  * _idt_rtc_irq_handler()
  * Input: None
  * Output: None
- * Side effect: handle the RTC interrupt properly
- * Note: get called frequently
+ * Side effect: handle the RTC interrupt properly; wake the readers whose
+ * virtual tick is due
+ * Note: get called RTC_HW_FREQ times a second; a tick with no reader due
+ * is one compare
  */
 void _idt_rtc_irq_handler()
 {
@@ -49,7 +81,27 @@ void _idt_rtc_irq_handler()
 		//printf("1"); Nothing to print for cp 4
 	}
 	// indicate the interrupt has occured
-	rtc_interrupt_occured = 1;
+	rtc_ticks++;
+	rtc_stats.hw_ticks++;
+	if(rtc_pending != NULL && (int32_t)(rtc_ticks - rtc_next_due) >= 0){
+		rtc_file_t** link = &rtc_pending;
+		rtc_file_t* file;
+		rtc_stats.scans++;
+		while((file = *link) != NULL){
+			if((int32_t)(rtc_ticks - file->next) >= 0){
+				*link = file->pending_next;	// due: off the list, reader goes
+				file->pending = 0;
+				sched_wake_all(&file->wait);
+				rtc_stats.wakeups++;
+				continue;
+			}
+			// first one left, or earlier than the earliest so far
+			if(link == &rtc_pending || (int32_t)(file->next - rtc_next_due) < 0){
+				rtc_next_due = file->next;
+			}
+			link = &file->pending_next;
+		}
+	}
 	// re-enable IRQ8
 	send_eoi(RTCIRQ8);
 	// re-enable all interrupts
@@ -81,104 +133,102 @@ void change_freq(uint8_t count)
 
 /*
  * rtc_open(const uint8_t* filename)
- * Note: set default frequency to 2 Hz
+ * Note: every open gets its own virtual rtc at 2 Hz; the chip is untouched
+ * return value: the per-fd state, NULL if out of memory
  */ 
-uint32_t rtc_open(const uint8_t* filename)
+void* rtc_open(const uint8_t* filename)
 {
-	cli();
-	outb(RTCREGA, RTCPORT1);						// select register A, and disable NMI
-	uint8_t prev;
-	prev = inb(RTCPORT2);							// read the current value of register A
-	outb(RTCREGA, RTCPORT1);						// set the index again (a read will reset the index to register D)
-	outb((prev & RTCUNUN) | BASENUM, RTCPORT2);	 	// write the previous value ORed with 0x40. This turns on bit 6 of register B
-	sti();
-	return 0;
-
+	rtc_file_t* file = (rtc_file_t*)kzalloc(sizeof(rtc_file_t));
+	if(file == NULL){
+		return NULL;
+	}
+	file->freq = RTC_DEFAULT_FREQ;
+	file->divisor = RTC_HW_FREQ / RTC_DEFAULT_FREQ;
+	file->next = rtc_ticks;
+	if(rtc_stats.open_files++ == 0){
+		enable_irq(RTCIRQ8);		// nobody to wake otherwise; keeps idle cpus idle
+	}
+	return file;
 }
 
 /*
  * rtc_read(int32_t fd, void* buf, int32_t nbytes)
- * Note: can return only after accept interrupt
+ * Note: can return only after accept interrupt; blocks until the next
+ * tick of this fd's virtual clock. Ticks stay in phase; ticks missed while
+ * the program was busy are skipped, not queued.
  */ 
 uint32_t rtc_read(int32_t fd, void* buf, int32_t nbytes)
 {
-	// should return after an interrupt has occured
-	// approach: set a flag and wait until the irq clear, then return
-	rtc_interrupt_occured = 0;
-	while(!rtc_interrupt_occured);	/* spin nicely, wait irq to clear the flag */
-
-
+	rtc_file_t* file = rtc_file(fd);
+	uint32_t flags, behind;
+	if(file == NULL){
+		return -1;
+	}
 
+	cli_and_save(flags);
+	// first virtual tick after now
+	behind = rtc_ticks - file->next;
+	if((int32_t)behind >= 0){
+		file->next += (behind / file->divisor + 1) * file->divisor;
+	}
+	while((int32_t)(rtc_ticks - file->next) < 0){
+		if(!file->pending){
+			file->pending = 1;
+			file->pending_next = rtc_pending;
+			if(rtc_pending == NULL || (int32_t)(file->next - rtc_next_due) < 0){
+				rtc_next_due = file->next;
+			}
+			rtc_pending = file;
+		}
+		sched_sleep(&file->wait);	/* other tasks or the idle loop run meanwhile */
+	}
+	restore_flags(flags);
 	return 0;
 }
 
 
 /*
  * rtc_write(int32_t fd, const void* buf, int32_t nbytes)
- * Note: use to write freuency to RTC 
+ * Note: use to write freuency to RTC; only changes this fd's divisor
  */
 uint32_t rtc_write(int32_t fd, const uint32_t* buf, int32_t nbytes)
 {
 	// can be used to change the rtc frequency: can be only a power of 2;
 	// up to 1024 Hz
-	// actually, hard code is better and faster: 2 to 1024
-	uint32_t rate;
-	switch (*buf) {		/* case represents frequency; has to be power of 2 */
-		case 2:				/* rate represents write in values for each frequency */
-			rate = 15;
-			break;
-		case 4:
-			rate = 14;
-			break;
-		case 8:
-			rate = 13;
-			break;
-		case 16:
-			rate = 12;
-			break;
-		case 32:
-			rate = 11;
-			break;
-		case 64:
-			rate = 10;
-			break;
-		case 128:
-			rate = 9;
-			break;
-		case 256:
-			rate = 8;
-			break;
-		case 512:
-			rate = 7;
-			break;
-		case 1024:
-			rate = 6;
-			break;
-		default:
-			rate = ERRORMAG;
+	rtc_file_t* file = rtc_file(fd);
+	uint32_t freq, flags;
+	if(file == NULL || buf == NULL){
+		return -1;
 	}
-	// check rate 
-	if(rate == ERRORMAG){
+	freq = *buf;
+	if(freq < RTC_MIN_FREQ || freq > RTC_HW_FREQ || (freq & (freq - 1)) != 0){
 		return -1;
-	}else{
-		// para passed; change frequency according to rate
-		cli();
-		outb(RTCREGA, RTCPORT1);				// set index to register A, disable NMI
-		uint8_t prev;
-		prev = inb(RTCPORT2);					// read the current value of register A
-		outb(RTCREGA, RTCPORT1);				// set the index again 
-		outb((prev & RTCUNUN) | rate, RTCPORT2); 	// write only our rate to A. Note, rate is the bottom 4 bits.
-		sti();
-		return DEFAULTB;
 	}
-	return -1;
+	cli_and_save(flags);
+	file->freq = freq;
+	file->divisor = RTC_HW_FREQ / freq;
+	file->next = rtc_ticks;		// new rate starts now
+	rtc_stats.rate_changes++;
+	restore_flags(flags);
+	return DEFAULTB;
 }
 
 /*
  * rtc_close(int32_t fd)
- * Note: just return
+ * Note: frees the fd's virtual rtc
  */
 uint32_t rtc_close(int32_t fd)
 {
+	rtc_file_t* file = rtc_file(fd);
+	pcb_t* pcb = get_pcb(curr_task_pos);
+	if(file == NULL){
+		return -1;
+	}
+	// no reader can sleep on it: the only one is the process closing it
+	pcb->file_array[fd].private_data = NULL;
+	kfree(file);
+	if(--rtc_stats.open_files == 0){
+		disable_irq(RTCIRQ8);
+	}
 	return 0;
 }
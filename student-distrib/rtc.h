@@ -9,6 +9,7 @@
 #include "x86_desc.h"
 #include "lib.h"
 #include "i8259.h"
+#include "wait.h"
 
 /* defined ports for RTC */
 #define RTCREGA 		0x8A
@@ -23,6 +24,33 @@
 #define RTCREGC 		0x8C
 #define ERRORMAG 		0x4F2E
 #define RTCUNUN			0xF0
+#define RTC_HW_FREQ		1024		// the chip always runs at this rate
+#define RTC_HW_RATE		6			// register A rate for RTC_HW_FREQ
+#define RTC_MIN_FREQ	2
+#define RTC_DEFAULT_FREQ 2			// virtual rate of a newly opened rtc
+
+/* one open rtc file: a virtual clock divided down from the hardware rate */
+typedef struct rtc_file_t_struct
+{
+	uint32_t freq;						// virtual frequency
+	uint32_t divisor;					// hardware ticks per virtual tick
+	uint32_t next;						// hardware tick of the next virtual tick
+	uint32_t pending;					// a reader sleeps until next
+	struct rtc_file_t_struct* pending_next;	// list of files with a sleeping reader
+	wait_queue_t wait;
+}rtc_file_t;
+
+/* rtc counters */
+typedef struct rtc_stats_t_struct
+{
+	uint32_t hw_ticks;				// hardware interrupts
+	uint32_t scans;					// interrupts that had a reader due
+	uint32_t wakeups;				// virtual ticks delivered to readers
+	uint32_t rate_changes;			// rtc_write calls; none touch the chip
+	uint32_t open_files;
+}rtc_stats_t;
+
+extern rtc_stats_t rtc_stats;
 
 /* initialization RTC device */
 extern void rtc_init();
@@ -30,8 +58,8 @@ extern void rtc_init();
 /* rtc interrupt handler */
 extern void _idt_rtc_irq_handler();
 
-/* rtc rtc_open */
-extern uint32_t rtc_open(const uint8_t* filename);
+/* rtc rtc_open; returns the per-fd state, NULL if out of memory */
+extern void* rtc_open(const uint8_t* filename);
 
 /* rtc rtc_read */
 extern uint32_t rtc_read(int32_t fd, void* buf, int32_t nbytes);
@@ -2,102 +2,529 @@
  */
 #include "sche.h"
 
-extern uint8_t runn_task_num;
-extern uint8_t curr_task_pos;
-extern uint8_t task_bitmap[MAXNUMTASK];
+extern volatile uint8_t curr_task_pos;
+extern pcb_t* task_table[MAXNUMTASK];
 extern ter_info terminal_array[TERMINAL_MAXNUM];
+extern uint32_t current_terminal_idx;
+
+sched_stats_t sched_stats;
+volatile int32_t sched_terminal = 0;
+volatile uint32_t sched_preempt_off = 0;
+/* process whose slice ran out while switching was held off */
+static pcb_t* sched_expired_pcb = NULL;
+
+/* stack a terminal's first shell is started on; execute never returns to it */
+static uint32_t launch_stack[LAUNCH_STACK_WORDS] __attribute__((aligned(16)));
+/* stack of the idle loop; it starts over each time the cpu goes idle */
+static uint32_t idle_stack[LAUNCH_STACK_WORDS] __attribute__((aligned(16)));
+/* saved stack of a context that is not a task (boot, idle, a failed launch); never resumed */
+static uint32_t orphan_esp;
+/* tsc at the start of the last switch */
+static uint64_t switch_start;
+/* ready processes of every level, and one bit per non-empty level */
+static pcb_t* run_head[SCHED_LEVELS];
+static pcb_t* run_tail[SCHED_LEVELS];
+static uint32_t run_bitmap;
+
+static void sched_dispatch(pcb_t* prev);
 
 /*
- *  int8_t get_next_availble_process()
+ *  uint32_t sched_slice(uint32_t level)
+ *	Input: level -- feedback queue level
+ *	Output: slice length in ticks; lower levels run less often but longer
+ *  Side effect: None
+ */
+static uint32_t sched_slice(uint32_t level)
+{
+	return SCHED_BASE_SLICE << level;
+}
+
+/*
+ *  void run_enqueue(pcb_t* pcb)
+ *	Input: pcb -- ready process, not on any queue
+ *	Output: None
+ *  Side effect: queue the process on the level of its priority. Processes of
+ *	the shown terminal go to the front of their level, the rest to the back.
+ */
+static void run_enqueue(pcb_t* pcb)
+{
+	uint32_t level = pcb->sched.priority;
+
+	pcb->sched.level = level;
+	if(run_head[level] == NULL)
+	{
+		pcb->sched.next = pcb->sched.prev = NULL;
+		run_head[level] = run_tail[level] = pcb;
+	}
+	else if(pcb->terminal == current_terminal_idx)
+	{
+		pcb->sched.prev = NULL;
+		pcb->sched.next = run_head[level];
+		run_head[level]->sched.prev = pcb;
+		run_head[level] = pcb;
+	}
+	else
+	{
+		pcb->sched.next = NULL;
+		pcb->sched.prev = run_tail[level];
+		run_tail[level]->sched.next = pcb;
+		run_tail[level] = pcb;
+	}
+	run_bitmap |= 1 << level;
+}
+
+/*
+ *  void run_dequeue(pcb_t* pcb)
+ *	Input: pcb -- process on a run queue
+ *	Output: None
+ *  Side effect: take the process off its queue
+ */
+static void run_dequeue(pcb_t* pcb)
+{
+	int32_t level = pcb->sched.level;
+
+	if(pcb->sched.prev != NULL)
+		pcb->sched.prev->sched.next = pcb->sched.next;
+	else
+		run_head[level] = pcb->sched.next;
+	if(pcb->sched.next != NULL)
+		pcb->sched.next->sched.prev = pcb->sched.prev;
+	else
+		run_tail[level] = pcb->sched.prev;
+	if(run_head[level] == NULL)
+		run_bitmap &= ~(1 << level);
+	pcb->sched.level = -1;
+}
+
+/*
+ *  uint32_t run_top()
  *	Input: None
- *	Output: int8_t next_task_pos
+ *	Output: highest non-empty level; run_bitmap must not be 0
  *  Side effect: None
- *	Find next possible task position for scheduling to run
  */
-int8_t get_next_availble_process()
+static uint32_t run_top()
+{
+	uint32_t level;
+	asm volatile("bsfl %1, %0" : "=r"(level) : "r"(run_bitmap));
+	return level;
+}
+
+/*
+ *  void sched_set_priority(pcb_t* pcb, uint32_t priority)
+ *	Input: pcb -- any live process
+ *		   priority -- new level
+ *	Output: None
+ *  Side effect: move the process to the level with a fresh slice, keeping
+ *	it on the run queue if it was on one
+ */
+static void sched_set_priority(pcb_t* pcb, uint32_t priority)
 {
-	int i, next_task_pos;	//return value
-	pcb_t* possible_pcb;	//temp pcb struct for test
-	for(i=1;i<MAXNUMTASK;i++)
+	int32_t queued = (pcb->sched.level >= 0);
+
+	if(queued)
+		run_dequeue(pcb);
+	pcb->sched.priority = priority;
+	pcb->sched.slice_left = sched_slice(priority);
+	if(queued)
+		run_enqueue(pcb);
+}
+
+/*
+ *  void sched_boost()
+ *	Input: None
+ *	Output: None
+ *  Side effect: put every process back on level 0, so processes that sank
+ *	cannot starve and programs that turned interactive recover
+ */
+static void sched_boost()
+{
+	int i;
+	for(i = 0; i < MAXNUMTASK; i++)
 	{
-		//calculate next possible task postion in 5 other positions
-		next_task_pos = (curr_task_pos+i) % (MAXNUMTASK - 1); 
-		//get pcb_t pointer
-		possible_pcb = (pcb_t *)(EIGHTMB - EIGHTKB * (next_task_pos + 1));
-		//check if the current pcb is running
-		if(possible_pcb->running_state != 0)
-			return next_task_pos;	//return the postion number if it's running
+		if(task_table[i] != NULL && task_table[i]->sched.priority != 0)
+			sched_set_priority(task_table[i], 0);
 	}
-	//return failure
-	return -1;
+	sched_stats.boosts++;
+}
+
+/*
+ *  int32_t sched_many_ready()
+ *	Input: None
+ *	Output: 1 if more than one process is ready, 0 otherwise
+ *  Side effect: None
+ */
+static int32_t sched_many_ready()
+{
+	if(run_bitmap == 0)
+		return 0;
+	if((run_bitmap & (run_bitmap - 1)) != 0)
+		return 1;
+	return run_head[run_top()] != run_tail[run_top()];
 }
 
 /*
- *  scheduling_handler()
+ *  void sched_tickless()
  *	Input: None
  *	Output: None
- *  Side effect: switch to next function
- *	save current esp and ebp, restore next esp and ebp
+ *  Side effect: called from the tick when the cpu goes to a process with
+ *	nobody else ready, or stays idle. No slice needs enforcing then, so the
+ *	pit switches to the longest one-shot instead of waking us every tick;
+ *	sched_wake_all and terminal_switch bring the periodic tick back.
+ */
+static void sched_tickless()
+{
+#if PIT_TICKLESS
+	pit_oneshot(MAX_COUNT);
+#endif
+}
+
+/*
+ *  void sched_task_init(pcb_t* pcb)
+ *	Input: pcb -- new process, not yet running
+ *	Output: None
+ *  Side effect: new processes start on level 0 with a full slice
+ */
+void sched_task_init(pcb_t* pcb)
+{
+	memset(&pcb->sched, 0, sizeof(pcb->sched));
+	pcb->sched.level = -1;
+	pcb->sched.slice_left = sched_slice(0);
+}
+
+/*
+ *  void sched_credit_terminal(int32_t terminal)
+ *	Input: terminal -- terminal that got a line of input
+ *	Output: None
+ *  Side effect: the terminal's process goes to level 0 so the reply to
+ *	the user is not stuck behind cpu hogs
  */
-void scheduling_handler()
+void sched_credit_terminal(int32_t terminal)
 {
-	return;
-	if(runn_task_num <= 1)
+	pcb_t* pcb;
+	if(terminal < 0 || terminal >= TERMINAL_MAXNUM)
+		return;
+	pcb = get_pcb(terminal_array[terminal].active_pid);
+	if(pcb == NULL || pcb->sched.priority == 0)
 		return;
-	//use helper function to get next possible task position
-	int8_t	next_task_pos;
-	next_task_pos = get_next_availble_process();
-	//no availble process to schedule, return and end this scheduling
-	if(next_task_pos == -1)
+	sched_set_priority(pcb, 0);
+	pcb->sched.credits++;
+}
+
+/*
+ *  int32_t sched_proc_stats(proc_stats_t* buf, int32_t max)
+ *	Input: buf -- records to fill
+ *		   max -- records that fit in buf
+ *	Output: number of records filled, one per live process
+ *  Side effect: None
+ */
+int32_t sched_proc_stats(proc_stats_t* buf, int32_t max)
+{
+	int32_t i, n;
+	uint32_t flags;
+	pcb_t* pcb;
+
+	cli_and_save(flags);
+	for(i = 0, n = 0; i < MAXNUMTASK && n < max; i++)
 	{
+		pcb = task_table[i];
+		if(pcb == NULL)
+			continue;
+		buf[n].pid = pcb->process_id;
+		buf[n].parent_pid = pcb->parent_process_id;
+		buf[n].terminal = pcb->terminal;
+		if(i == curr_task_pos)
+			buf[n].state = PROC_RUNNING;
+		else if(pcb->sched.level >= 0)
+			buf[n].state = PROC_READY;
+		else if(pcb->sched.wait != NULL)
+			buf[n].state = PROC_SLEEPING;
+		else
+			buf[n].state = PROC_WAITING;
+		buf[n].priority = pcb->sched.priority;
+		buf[n].ticks = pcb->sched.ticks;
+		buf[n].dispatches = pcb->sched.dispatches;
+		buf[n].expired = pcb->sched.expired;
+		buf[n].credits = pcb->sched.credits;
+		buf[n].sleeps = pcb->sched.sleeps;
+		memcpy(buf[n].name, pcb->name, PROC_NAME_LEN);
+		n++;
+	}
+	restore_flags(flags);
+	return n;
+}
+
+/*
+ *  void sched_set_active(int32_t terminal, int32_t pos)
+ *	Input: terminal -- terminal index
+ *		   pos -- task position of its running process, -1 for none
+ *	Output: None
+ *  Side effect: pos is the newest process of the terminal, the one its
+ *	input goes to; its parents wait in execute, off the run queues.
+ */
+void sched_set_active(int32_t terminal, int32_t pos)
+{
+	if(terminal >= 0 && terminal < TERMINAL_MAXNUM)
+		terminal_array[terminal].active_pid = pos;
+}
+
+/*
+ *  int32_t sched_booting_terminal()
+ *	Input: None
+ *	Output: a terminal waiting for its first shell, -1 if none
+ *  Side effect: None
+ */
+static int32_t sched_booting_terminal()
+{
+	int32_t t;
+	for(t = 0; t < TERMINAL_MAXNUM; t++)
+	{
+		if(terminal_array[t].terminal_state == TERM_BOOTING)
+			return t;
+	}
+	return -1;
+}
+
+/*
+ *  uint32_t sched_fresh_frame(uint32_t* stack, void (*entry)())
+ *	Input: stack -- LAUNCH_STACK_WORDS words to start on
+ *		   entry -- function to run there; it never returns
+ *	Output: stack pointer for context_switch
+ *  Side effect: builds a frame that context_switch "returns" into entry
+ *	from, with interrupts off
+ */
+static uint32_t sched_fresh_frame(uint32_t* stack, void (*entry)())
+{
+	uint32_t* frame = &stack[LAUNCH_STACK_WORDS - LAUNCH_FRAME_WORDS];
+	memset(frame, 0, LAUNCH_FRAME_WORDS * sizeof(uint32_t));
+	frame[0] = EFLAGS_BASE;
+	frame[5] = (uint32_t)entry;
+	return (uint32_t)frame;
+}
+
+/*
+ *  void sched_account()
+ *	Input: None
+ *	Output: None
+ *  Side effect: called by a task right after it is switched back to;
+ *	adds the time since the switch decision to the switch counters
+ */
+static void sched_account()
+{
+	uint32_t cycles = (uint32_t)(rdtsc() - switch_start);
+	sched_stats.switch_cycles += cycles;
+	if(cycles > sched_stats.max_switch_cycles)
+		sched_stats.max_switch_cycles = cycles;
+}
+
+/*
+ *  void sched_idle()
+ *	Input: None
+ *	Output: None
+ *  Side effect: runs on the idle stack while no process is ready. Halts
+ *	until an interrupt, and hands the cpu to whatever it woke up.
+ */
+static void sched_idle()
+{
+	while(1)
+	{
+		cli();
+		if(run_bitmap != 0)
+			sched_dispatch(NULL);
+		asm volatile("sti; hlt");
+	}
+}
+
+/*
+ *  void sched_launch()
+ *	Input: None
+ *	Output: None
+ *  Side effect: first code run on the launch stack; starts the shell of
+ *	sched_terminal. Only comes back if the shell cannot start, then the
+ *	cpu goes to the idle loop.
+ */
+static void sched_launch()
+{
+	terminal_boot(sched_terminal);
+	terminal_array[sched_terminal].terminal_state = TERM_INACTIVE;
+	context_switch(&orphan_esp, sched_fresh_frame(idle_stack, sched_idle));
+}
+
+/*
+ *  void sched_dispatch(pcb_t* prev)
+ *	Input: prev -- running process, already queued or asleep; NULL when the
+ *				   cpu is in the idle loop
+ *	Output: None
+ *  Side effect: switch to the first ready process of the highest level, or
+ *	to the idle loop if none is ready. Interrupts must be off. Returns when
+ *	prev is switched back to.
+ */
+static void sched_dispatch(pcb_t* prev)
+{
+	uint32_t* prev_esp = (prev != NULL) ? (uint32_t*)&prev->esp : &orphan_esp;
+	pcb_t* next;
+
+	if(run_bitmap == 0)
+	{
+		if(prev == NULL)
+			return;
+		// kernel mappings are global, so the idle loop can keep prev's cr3
+		curr_task_pos = NO_TASK;
+		sched_stats.idle_entries++;
+		context_switch(prev_esp, sched_fresh_frame(idle_stack, sched_idle));
+	}
+	else
+	{
+		next = run_head[run_top()];
+		run_dequeue(next);
+		if(next == prev)
+			return;
+		switch_start = rdtsc();
+		sched_terminal = next->terminal;
+		curr_task_pos = next->process_id;
+		// first modify the tss
+		tss.ss0 = KERNEL_DS;
+		tss.esp0 = (uint32_t)next + EIGHTKB - 4;		// top of next task's kernel stack
+		// set paging up; new process -> its own page directory
+		load_page_dir(next->page_dir);
+		next->sched.dispatches++;
+		sched_stats.switches++;
+		context_switch(prev_esp, next->esp);
+	}
+	// back on this task's stack, resumed by a later switch
+	sched_account();
+}
+
+/*
+ *  void sched_sleep(wait_queue_t* wq)
+ *	Input: wq -- queue to sleep on
+ *	Output: None
+ *  Side effect: block the calling process until sched_wake_all(wq); other
+ *	processes or the idle loop run meanwhile. Call with interrupts off,
+ *	after checking the condition, and check it again on return:
+ *		cli_and_save(flags);
+ *		while(!condition)
+ *			sched_sleep(&wq);
+ *		restore_flags(flags);
+ */
+void sched_sleep(wait_queue_t* wq)
+{
+	pcb_t* pcb = get_pcb(curr_task_pos);
+	if(pcb == NULL)
 		return;
+
+	pcb->sched.next = NULL;
+	if(wq->tail != NULL)
+		wq->tail->sched.next = pcb;
+	else
+		wq->head = pcb;
+	wq->tail = pcb;
+	pcb->sched.wait = wq;
+	pcb->sched.sleeps++;
+	sched_stats.sleeps++;
+	sched_dispatch(pcb);
+}
+
+/*
+ *  void sched_wake_all(wait_queue_t* wq)
+ *	Input: wq -- queue to empty
+ *	Output: None
+ *  Side effect: every sleeper goes back on the run queue of its level. Safe
+ *	from interrupt handlers; the switch happens on the next tick, or right
+ *	away if the cpu is idle.
+ */
+void sched_wake_all(wait_queue_t* wq)
+{
+	pcb_t* pcb;
+	while((pcb = wq->head) != NULL)
+	{
+		wq->head = pcb->sched.next;
+		pcb->sched.wait = NULL;
+		run_enqueue(pcb);
+		sched_stats.wakeups++;
 	}
-	//find currently running pcb struct and next pcb struct
-	pcb_t* curr_pcb;
-	pcb_t* next_pcb;
-	curr_pcb = (pcb_t *)(EIGHTMB - EIGHTKB * (curr_task_pos + 1));
-	next_pcb = (pcb_t *)(EIGHTMB - EIGHTKB * (next_task_pos + 1));		
-
-	// set paging up; new process -> 128MB
-	int32_t temp;
-	page_dir[PAGEINDEX] = 0;
-	page_dir[PAGEINDEX] = SET_RW_NOT_PRESENT;
-	// re-initialization and then set
-	page_dir[PAGEINDEX] |= PAGE_4MB; 
-	page_dir[PAGEINDEX] |= SET_RW_PRESENT; 
-	page_dir[PAGEINDEX] |= USER;
-	temp = KERNEL_TASK_ADDR + FOURMB * next_task_pos;		// set physical --> different physical to same virtual
-	temp &= BITS20_MASK;
-	page_dir[PAGEINDEX] |= temp;
-	//flush the tlb for paging re-map
-	flush_tlb();
-
-	// first modify the tss
-	tss.ss0 = KERNEL_DS;
-    tss.esp0 = EIGHTMB - EIGHTKB * next_task_pos  - 4;		// from piazza
-
-
-    //save current esp and ebp to current pcb struct
-	asm volatile(
-		"movl %%esp, %0;"
-		"movl %%ebp, %1;"
-		:"=g"(curr_pcb->esp), "=g"(curr_pcb->ebp)
-		:
-		:"memory"
-	);
-	//restore esp and ebp from next pcb struct
-	asm volatile(
-				"movl %0, %%esp;"
-				"movl %1, %%ebp;"
-				:
-				:"g"(next_pcb->esp),"g"(next_pcb->ebp)
-				:"memory","%esp","%ebp"
-				);
-	//return, end schedulling interrupt
-	asm volatile(
-				"leave;"
-				"ret;"
-		);
+	wq->tail = NULL;
+	// someone may have to share the cpu now; slices need the tick again
+	pit_periodic();
 }
 
+/*
+ *  scheduling_handler(uint32_t ticks)
+ *	Input: ticks -- ticks since the last call; more than 1 after a one-shot
+ *	Output: None
+ *  Side effect: charge the ticks to the running process and switch when its
+ *	slice is used up, a higher level has a ready process, or a terminal
+ *	waits to boot. A used-up slice moves the process one level down.
+ *	While sched_preempt_off is set the ticks are still charged, only the
+ *	switch waits for a later tick.
+ *	Called from the pit interrupt with interrupts off and the eoi already
+ *	sent. The interrupted context sits on this task's kernel stack, so the
+ *	switch only has to swap kernel stacks, esp0 and the page directory.
+ */
+void scheduling_handler(uint32_t ticks)
+{
+	int32_t boot, expired;
+	pcb_t* prev_pcb;
+
+	sched_stats.ticks += ticks;
+	prev_pcb = get_pcb(curr_task_pos);
+	expired = (prev_pcb != NULL && prev_pcb == sched_expired_pcb);
+	sched_expired_pcb = NULL;
+	if(prev_pcb != NULL)
+	{
+		prev_pcb->sched.ticks += ticks;
+		prev_pcb->sched.slice_left = (prev_pcb->sched.slice_left > ticks) ? prev_pcb->sched.slice_left - ticks : 0;
+		if(prev_pcb->sched.slice_left == 0)
+		{
+			expired = 1;
+			prev_pcb->sched.expired++;
+			sched_set_priority(prev_pcb, (prev_pcb->sched.priority < SCHED_LEVELS - 1) ? prev_pcb->sched.priority + 1 : prev_pcb->sched.priority);
+		}
+	}
+	else
+	{
+		sched_stats.idle_ticks += ticks;
+		if(ticks > 1)
+			pit_stats.idle_saved_ticks += ticks - 1;
+	}
+	if(sched_stats.ticks / SCHED_BOOST_TICKS != (sched_stats.ticks - ticks) / SCHED_BOOST_TICKS)
+		sched_boost();
+
+	if(sched_preempt_off)
+	{
+		// inside a section that must not be switched away from; a used-up
+		// slice still gets its switch on the first tick after it
+		sched_expired_pcb = expired ? prev_pcb : NULL;
+		pit_periodic();
+		return;
+	}
+
+	boot = sched_booting_terminal();
+	if(boot == -1)
+	{
+		if(run_bitmap == 0)
+		{
+			sched_tickless();
+			return;
+		}
+		if(prev_pcb != NULL && !expired && run_top() >= prev_pcb->sched.priority)
+			return;
+	}
+	if(prev_pcb != NULL)
+		run_enqueue(prev_pcb);
 
+	if(boot != -1)
+	{
+		// fresh stack that "returns" into sched_launch with interrupts off
+		sched_terminal = boot;
+		terminal_array[boot].terminal_state = TERM_ACTIVE;
+		curr_task_pos = NO_TASK;
+		sched_stats.launches++;
+		context_switch((prev_pcb != NULL) ? (uint32_t*)&prev_pcb->esp : &orphan_esp,
+			sched_fresh_frame(launch_stack, sched_launch));
+		sched_account();
+		return;
+	}
+	if(!sched_many_ready())
+		sched_tickless();
+	sched_dispatch(prev_pcb);
+}
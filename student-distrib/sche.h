@@ -10,17 +10,41 @@
 #include "syscall.h"
 #include "paging.h"
 #include "terminal.h"
+#include "sched_stats.h"
 
 
 #define EIGHTKB				0x00002000
 #define EIGHTMB				0x00800000
 #define FOURMB				0x00400000
-#define MAXNUMTASK			6
 #define TERMINAL_MAXNUM		3
+#define LAUNCH_STACK_WORDS	1024		// 4KB stack a terminal's first shell is started on
+#define LAUNCH_FRAME_WORDS	7			// eflags, edi, esi, ebx, ebp, eip, return address
+#define EFLAGS_BASE			0x00000002	// reserved bit 1; IF clear
+#define SCHED_LEVELS		4			// feedback queue levels, 0 runs first
+#define SCHED_BASE_SLICE	1			// ticks in a level 0 slice; doubles per level
+#define SCHED_BOOST_TICKS	50			// every process goes back to level 0 once a second
 
-/* Scheduler, switch tasks */
-void scheduling_handler();
-/* Helper function of scheduling */
-int8_t get_next_availble_process();
+extern sched_stats_t sched_stats;
+/* terminal whose process owns the cpu */
+extern volatile int32_t sched_terminal;
+/* nonzero: the tick must not switch away (interrupt bottom halves running with interrupts on) */
+extern volatile uint32_t sched_preempt_off;
+
+/* Scheduler, switch tasks; ticks is the time since the last call */
+void scheduling_handler(uint32_t ticks);
+/* Record the process that runs for a terminal */
+void sched_set_active(int32_t terminal, int32_t pos);
+/* Start a new process at the top level with a full slice */
+void sched_task_init(pcb_t* pcb);
+/* A line was typed for a terminal: lift its process to the top level */
+void sched_credit_terminal(int32_t terminal);
+/* Fill up to max records about live processes; returns the count */
+int32_t sched_proc_stats(proc_stats_t* buf, int32_t max);
+/* Block the calling process on a wait queue; interrupts must be off */
+void sched_sleep(wait_queue_t* wq);
+/* Make every process on a wait queue ready */
+void sched_wake_all(wait_queue_t* wq);
+/* Save this kernel stack in *prev_esp and resume the one at next_esp */
+void context_switch(uint32_t* prev_esp, uint32_t next_esp);
 
 #endif
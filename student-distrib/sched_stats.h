@@ -0,0 +1,47 @@
+/* sched_stats.h - Scheduler records handed out by stats(STATS_SCHED) and
+ * stats(STATS_PROC); included by the kernel and by the user programs that
+ * read them, so the two sides cannot drift apart. Only fixed-size types.
+ */
+
+#ifndef SCHED_STATS_H
+#define SCHED_STATS_H
+
+#define PROC_MAX			128			// processes the kernel can hold (MAXNUMTASK)
+#define PROC_NAME_LEN		20			// CMDLENGTH in syscall.h
+#define PROC_RUNNING		0			// proc_stats_t states
+#define PROC_READY			1
+#define PROC_WAITING		2			// parent waiting in execute
+#define PROC_SLEEPING		3			// blocked on a wait queue
+
+/* scheduler counters */
+typedef struct sched_stats_t_struct
+{
+	uint32_t ticks;					// timer ticks seen by the scheduler, skipped ones included
+	uint32_t switches;				// task to task switches
+	uint32_t launches;				// terminal shells started from the tick
+	uint32_t boosts;				// periodic returns of everyone to level 0
+	uint32_t sleeps;				// processes blocked on wait queues
+	uint32_t wakeups;				// processes woken from wait queues
+	uint32_t idle_entries;			// times the cpu went to the idle loop
+	uint32_t idle_ticks;			// ticks that found the cpu idle
+	uint32_t max_switch_cycles;		// slowest switch
+	uint64_t switch_cycles;			// tsc cycles from the switch decision to the resumed task
+}sched_stats_t;
+
+/* one process as reported by stats(STATS_PROC) */
+typedef struct proc_stats_t_struct
+{
+	int32_t pid;
+	int32_t parent_pid;
+	int32_t terminal;
+	uint32_t state;					// PROC_RUNNING/READY/WAITING/SLEEPING
+	uint32_t priority;
+	uint32_t ticks;
+	uint32_t dispatches;
+	uint32_t expired;
+	uint32_t credits;
+	uint32_t sleeps;
+	uint8_t name[PROC_NAME_LEN];
+}proc_stats_t;
+
+#endif /* SCHED_STATS_H */
@@ -0,0 +1,203 @@
+/* serial.c - Interrupt driven 16550 uart on COM1, used as a console sink
+ */
+#include "serial.h"
+#include "lib.h"
+#include "i8259.h"
+#include "keyboard.h"
+
+serial_stats_t serial_stats;
+uint32_t console_sink = CONSOLE_VGA;
+
+/*
+ * Both rings are single producer, single consumer with free-running
+ * indices: only the producer moves head, only the consumer moves tail, so
+ * neither side needs a lock. The tx producer is whoever prints (always
+ * with interrupts off, so printers do not race each other) and the
+ * consumer is the uart interrupt; for rx it is the other way round.
+ */
+static uint8_t tx_buf[SERIAL_TX_SIZE];
+static volatile uint32_t tx_head, tx_tail;
+static uint8_t rx_buf[SERIAL_RX_SIZE];
+static volatile uint32_t rx_head, rx_tail;
+static uint32_t serial_present;		// a uart answered the probe
+static uint32_t tx_irq_on;			// THRE interrupt enabled
+
+/*
+ *  serial_init()
+ *	Input: None
+ *	Output: None
+ *  Side effect: program COM1 for 115200 8N1 with fifos and enable the
+ *	receive interrupt. The transmit interrupt is only on while the tx
+ *	ring has data. Bytes queued before this are sent now.
+ */
+void serial_init()
+{
+	outb(SCRATCH_PROBE, COM1_PORT + UART_SCRATCH);
+	if(inb(COM1_PORT + UART_SCRATCH) != SCRATCH_PROBE)
+		return;		// no uart: output to the serial sink is dropped
+	outb(0, COM1_PORT + UART_IER);
+	outb(LCR_DLAB, COM1_PORT + UART_LCR);
+	outb(UART_DIVISOR & 0xFF, COM1_PORT + UART_DATA);
+	outb(UART_DIVISOR >> 8, COM1_PORT + UART_IER);
+	outb(LCR_8N1, COM1_PORT + UART_LCR);
+	outb(FCR_ENABLE_CLEAR, COM1_PORT + UART_IIR_FCR);
+	outb(MCR_DTR_RTS_OUT2, COM1_PORT + UART_MCR);
+	serial_present = 1;
+	tx_irq_on = (tx_head != tx_tail);
+	outb(tx_irq_on ? (IER_RX | IER_TX) : IER_RX, COM1_PORT + UART_IER);
+	enable_irq(COM1_IRQ);
+}
+
+/*
+ *  serial_put_byte(uint8_t c)
+ *	Input: c -- byte to send
+ *	Output: None
+ *  Side effect: append to the tx ring and make sure the transmit interrupt
+ *	is on. A full ring means the writer outran the uart by SERIAL_TX_SIZE
+ *	bytes; then the oldest byte is sent by polling to make room, so
+ *	nothing is lost.
+ */
+static void serial_put_byte(uint8_t c)
+{
+	uint32_t flags;
+
+	cli_and_save(flags);
+	if(tx_head - tx_tail == SERIAL_TX_SIZE)
+	{
+		if(!serial_present)
+			tx_tail++;		// no uart yet: keep the newest output
+		else
+		{
+			while(!(inb(COM1_PORT + UART_LSR) & LSR_THRE))
+				;
+			outb(tx_buf[tx_tail & (SERIAL_TX_SIZE - 1)], COM1_PORT + UART_DATA);
+			tx_tail++;
+			serial_stats.tx_bytes++;
+		}
+		serial_stats.tx_stalls++;
+	}
+	tx_buf[tx_head & (SERIAL_TX_SIZE - 1)] = c;
+	tx_head++;
+	if(serial_present && !tx_irq_on)
+	{
+		tx_irq_on = 1;
+		outb(IER_RX | IER_TX, COM1_PORT + UART_IER);
+	}
+	restore_flags(flags);
+}
+
+/*
+ *  serial_putc(uint8_t c)
+ *	Input: c -- console character
+ *	Output: None
+ *  Side effect: queue it, with a carriage return before each newline
+ */
+void serial_putc(uint8_t c)
+{
+	if(c == '\n')
+		serial_put_byte('\r');
+	serial_put_byte(c);
+}
+
+/*
+ *  serial_write(const uint8_t* buf, int32_t nbytes)
+ *	Input: buf, nbytes -- raw bytes
+ *	Output: None
+ *  Side effect: queue them unchanged
+ */
+void serial_write(const uint8_t* buf, int32_t nbytes)
+{
+	int32_t i;
+	for(i = 0; i < nbytes; i++)
+		serial_put_byte(buf[i]);
+}
+
+/*
+ *  serial_tx_fill()
+ *	Input: None
+ *	Output: None
+ *  Side effect: refill the empty transmit fifo from the ring; the
+ *	transmit interrupt goes off once the ring is empty
+ */
+static void serial_tx_fill()
+{
+	uint32_t n;
+
+	for(n = 0; n < UART_FIFO_SIZE && tx_tail != tx_head; n++)
+	{
+		outb(tx_buf[tx_tail & (SERIAL_TX_SIZE - 1)], COM1_PORT + UART_DATA);
+		tx_tail++;
+	}
+	serial_stats.tx_bytes += n;
+	if(tx_tail == tx_head)
+	{
+		tx_irq_on = 0;
+		outb(IER_RX, COM1_PORT + UART_IER);
+	}
+}
+
+/*
+ *  serial_rx_pop(uint8_t* c)
+ *	Input: c -- where to put the byte
+ *	Output: 1 if a received byte was taken, 0 if the rx ring is empty
+ *  Side effect: the rx ring's only consumer, keyboard_drain(); call with
+ *	interrupts off
+ */
+int32_t serial_rx_pop(uint8_t* c)
+{
+	if(rx_tail == rx_head)
+		return 0;
+	*c = rx_buf[rx_tail & (SERIAL_RX_SIZE - 1)];
+	rx_tail++;
+	return 1;
+}
+
+/*
+ *  serial_rx_key(uint8_t c)
+ *	Input: c -- received byte
+ *	Output: None
+ *  Side effect: hand it to the shown terminal's line editing, the same way
+ *	keys are handled, when serial is a console sink
+ */
+void serial_rx_key(uint8_t c)
+{
+	if(!(console_sink & CONSOLE_SERIAL))
+		return;
+	if(c == '\r' || c == '\n')
+		keyboard_buffer_edit(3, 0);		// enter
+	else if(c == ASCII_DEL || c == ASCII_BS)
+		keyboard_buffer_edit(0, 0);		// backspace
+	else if(c >= PRINTABLE_START && c <= PRINTABLE_END)
+		keyboard_buffer_edit(1, c);
+}
+
+/*
+ *  _idt_serial_irq_handler()
+ *	Input: None
+ *	Output: None
+ *  Side effect: move received bytes into the rx ring and refill the
+ *	transmit fifo, then hand the input to keyboard_drain(), which decodes
+ *	it together with the keyboard's.
+ */
+void _idt_serial_irq_handler()
+{
+	uint8_t lsr;
+
+	serial_stats.irqs++;
+	while((lsr = inb(COM1_PORT + UART_LSR)) & LSR_DR)
+	{
+		serial_stats.rx_bytes++;
+		if(rx_head - rx_tail == SERIAL_RX_SIZE)
+		{
+			(void)inb(COM1_PORT + UART_DATA);
+			serial_stats.rx_dropped++;
+			continue;
+		}
+		rx_buf[rx_head & (SERIAL_RX_SIZE - 1)] = inb(COM1_PORT + UART_DATA);
+		rx_head++;
+	}
+	if((lsr & LSR_THRE) && tx_irq_on)
+		serial_tx_fill();
+	send_eoi(COM1_IRQ);
+	keyboard_drain();
+}
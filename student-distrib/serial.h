@@ -0,0 +1,65 @@
+/* serial.h - Defines used in interactions with the 16550 uart on COM1
+ */
+
+#ifndef SERIAL_H
+#define SERIAL_H
+
+#include "types.h"
+
+#define COM1_PORT			0x3F8
+#define COM1_IRQ			4
+#define UART_DATA			0			// rbr/thr; divisor low with DLAB
+#define UART_IER			1			// divisor high with DLAB
+#define UART_IIR_FCR		2
+#define UART_LCR			3
+#define UART_MCR			4
+#define UART_LSR			5
+#define UART_SCRATCH		7
+#define UART_DIVISOR		1			// 115200 baud
+#define LCR_DLAB			0x80
+#define LCR_8N1				0x03
+#define FCR_ENABLE_CLEAR	0xC7		// fifos on and cleared, rx trigger at 14 bytes
+#define MCR_DTR_RTS_OUT2	0x0B		// out2 gates the irq line
+#define IER_RX				0x01		// received data available
+#define IER_TX				0x02		// transmit holding register empty
+#define LSR_DR				0x01
+#define LSR_THRE			0x20
+#define UART_FIFO_SIZE		16
+#define SCRATCH_PROBE		0xA5
+#define SERIAL_TX_SIZE		16384		// ring sizes, powers of 2
+#define SERIAL_RX_SIZE		256
+#define ASCII_DEL			0x7F
+#define ASCII_BS			0x08
+
+/* where putc sends console output; CONSOLE_MIRROR sends it to both */
+#define CONSOLE_VGA			0x1
+#define CONSOLE_SERIAL		0x2
+#define CONSOLE_MIRROR		(CONSOLE_VGA | CONSOLE_SERIAL)
+
+/* uart counters */
+typedef struct serial_stats_t_struct
+{
+	uint32_t irqs;
+	uint32_t tx_bytes;				// bytes handed to the uart
+	uint32_t rx_bytes;
+	uint32_t tx_stalls;				// writes that found the ring full and waited for the uart
+	uint32_t rx_dropped;			// received bytes lost to a full ring
+}serial_stats_t;
+
+extern serial_stats_t serial_stats;
+extern uint32_t console_sink;
+
+/* Probe and program COM1, enable its interrupt */
+void serial_init();
+/* Queue one console character; '\n' goes out as "\r\n" */
+void serial_putc(uint8_t c);
+/* Take a received byte; keyboard_drain() only, interrupts off */
+int32_t serial_rx_pop(uint8_t* c);
+/* Line-edit a received byte on the shown terminal */
+void serial_rx_key(uint8_t c);
+/* Queue bytes as they are */
+void serial_write(const uint8_t* buf, int32_t nbytes);
+/* COM1 interrupt handler */
+void _idt_serial_irq_handler();
+
+#endif
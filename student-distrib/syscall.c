@@ -8,14 +8,19 @@
 #include "keyboard.h"
 #include "filesys.h"
 #include "paging.h"
+#include "kmalloc.h"
 #include "rtc.h"
+#include "sche.h"
+#include "clock.h"
+#include "profile.h"
+#include "bootopt.h"
+#include "serial.h"
 
 /* page directory and page table entries from paging.h */
 extern uint32_t page_dir[PDE_SIZE] __attribute__((aligned(PGE_SIZE)));
 extern uint32_t page_tab[PTE_SIZE] __attribute__((aligned(PGE_SIZE)));
 
 /* extern defined read functions */
-extern int32_t filesys_read_helper(const uint8_t* fname, uint32_t offset, uint8_t* buf, uint32_t length);
 extern int32_t fs_dir_ls_read_helper(const uint8_t* fname, uint32_t offset, uint8_t* buf, uint32_t length);
 
 
@@ -23,18 +28,187 @@ extern int32_t fs_dir_ls_read_helper(const uint8_t* fname, uint32_t offset, uint
 static volatile funcptr stdin_op_table[FOPTABLESIZE] = {NULL, (funcptr)&terminal_read, NULL, NULL};
 /* stdout: keyboard output */
 static volatile funcptr stdout_op_table[FOPTABLESIZE] = {NULL, NULL, (funcptr)&terminal_write, NULL};
-/* rtc syscall table */
-static volatile funcptr rtc_fop_table[FOPTABLESIZE] = {(funcptr)&rtc_open, (funcptr)&rtc_read, (funcptr)&rtc_write, (funcptr)&rtc_close};
+/* rtc syscall table; open() calls rtc_open itself for the per-fd state */
+static volatile funcptr rtc_fop_table[FOPTABLESIZE] = {NULL, (funcptr)&rtc_read, (funcptr)&rtc_write, (funcptr)&rtc_close};
 /* dir syscall table */
 static volatile funcptr fs_dir_fop_table[FOPTABLESIZE] = {(funcptr)&fs_dir_open, (funcptr)&fs_dir_read, (funcptr)&fs_dir_write, (funcptr)&fs_dir_close};
+/* profiler histogram special file; open() calls profile_open itself for the snapshot */
+static volatile funcptr profile_fop_table[FOPTABLESIZE] = {NULL, (funcptr)&profile_read, (funcptr)&profile_write, (funcptr)&profile_close};
 /* file syscall table */
 static volatile funcptr file_fop_table[FOPTABLESIZE] = {(funcptr)&filesys_open, (funcptr)&filesys_read, (funcptr)&filesys_write, (funcptr)&filesys_close};
 
 /* several global variables */
-volatile uint8_t runn_task_num = 0;		// range from 0 - 6
-volatile uint8_t curr_task_pos = 0;		// current task position indicator; 0 as first task shell 
+volatile uint8_t runn_task_num = 0;		// number of live tasks
+volatile uint8_t curr_task_pos = NO_TASK;		// current task position indicator; NO_TASK until the first shell
 volatile uint8_t task_bitmap[MAXNUMTASK] = {0};	// task bitmap to find proper position in kernel task
 volatile int32_t addr_saver;
+syscall_stats_t syscall_stats;			// system-wide system call counters
+
+/* pcb (and kernel stack) of each task position, NULL when free */
+pcb_t* task_table[MAXNUMTASK];
+/* how execute() brings the program image into memory */
+volatile uint32_t exec_load_mode = EXEC_LOAD_DEMAND;
+
+/*
+ * pcb_t* get_pcb(uint32_t pos);
+ * look up the pcb of a task position
+ * return value: pcb pointer, NULL if no task runs there
+ */
+pcb_t* get_pcb(uint32_t pos)
+{
+	if(pos >= MAXNUMTASK){
+		return NULL;
+	}
+	return task_table[pos];
+}
+
+/*
+ * int32_t copy_program_image(dentry_t* dentry, uint32_t* table, uint32_t size);
+ * eager load: give every image page its own frame and copy the file in
+ * return value: bytes loaded, -1 if memory ran out or the read failed
+ */
+static int32_t copy_program_image(dentry_t* dentry, uint32_t* table, uint32_t size)
+{
+	uint32_t k, count, frame;
+
+	for(k = 0; k < size; k += PAGE_BYTES){
+		frame = paging_alloc_user_page(table, LOADADDR + k);
+		if(frame == 0){
+			return -1;
+		}
+		count = (size - k > PAGE_BYTES) ? PAGE_BYTES : size - k;
+		if(read_data(dentry->inode_index, k, (uint8_t*)frame, count) != count){
+			return -1;
+		}
+		paging_stats.pages_copied++;
+	}
+	return size;
+}
+
+/*
+ * int32_t map_program_image(dentry_t* dentry, uint32_t* table, uint32_t size);
+ * zero-copy load: point the image pages straight at the (4KB aligned) data
+ * blocks of the fs image, read-only and copy-on-write. Only the last
+ * partial page gets a private frame, so that whatever follows the end of
+ * the file in that page starts out zeroed rather than shared with the image.
+ * return value: 0 on success, -1 if the image cannot be mapped (caller copies)
+ */
+static int32_t map_program_image(dentry_t* dentry, uint32_t* table, uint32_t size)
+{
+	inode_t* inode_ptr = get_inode(dentry->inode_index);
+	uint32_t full_pages = size / PAGE_BYTES;
+	uint32_t tail = size & PAGE_OFFSET_MASK;
+	uint32_t k, block_addr, frame;
+
+	if(inode_ptr == NULL){
+		return -1;
+	}
+	for(k = 0; k < full_pages; k++){
+		block_addr = get_data_block_addr(inode_ptr, k);
+		if(block_addr == 0 || (block_addr & PAGE_OFFSET_MASK)){
+			// bad block or image not page aligned: undo and let caller copy
+			memset(table, 0, PGE_SIZE);
+			return -1;
+		}
+		paging_map_user_page(table, LOADADDR + k * PAGE_BYTES, block_addr, PTE_COW | USER | PAGE_PRESENT);
+	}
+	paging_stats.pages_mapped += full_pages;
+	if(tail != 0){
+		frame = paging_alloc_user_page(table, LOADADDR + full_pages * PAGE_BYTES);
+		if(frame == 0 || read_data(dentry->inode_index, full_pages * PAGE_BYTES, (uint8_t*)frame, tail) != tail){
+			return -1;
+		}
+		paging_stats.pages_copied++;
+	}
+	return 0;
+}
+
+/*
+ * void demand_program_image(dentry_t* dentry, pcb_t* pcb, uint32_t size);
+ * lazy load: mark the image pages not present and remember the file in the
+ * pcb, so program_page_fault() brings each page in on first touch. Nothing
+ * of the file is read here.
+ * return value: none
+ */
+static void demand_program_image(dentry_t* dentry, pcb_t* pcb, uint32_t size)
+{
+	uint32_t k;
+
+	for(k = 0; k < size; k += PAGE_BYTES){
+		paging_map_user_page(pcb->page_table, LOADADDR + k, 0, PTE_DEMAND);
+	}
+	pcb->image.inode_index = dentry->inode_index;
+	pcb->image.size = size;
+}
+
+/*
+ * int32_t program_page_fault(uint32_t fault_addr, uint32_t error_code);
+ * page fault hook for the user page of the current task. Copies a shared
+ * image page on write, loads a demand page from the program file, or backs
+ * any other untouched page (stack, bss) with a zeroed frame. Full file pages
+ * whose data block is page aligned are mapped from the fs image
+ * copy-on-write; the rest are copied into a new frame.
+ * return value: 0 if resolved, -1 if it is a real fault
+ */
+int32_t program_page_fault(uint32_t fault_addr, uint32_t error_code)
+{
+	pcb_t* curr_pcb = get_pcb(curr_task_pos);
+	uint32_t* table;
+	exec_image_t* image;
+	uint32_t index, page, offset, count, block_addr, frame;
+
+	if(curr_pcb == NULL || curr_pcb->page_table == NULL){
+		return -1;
+	}
+	table = curr_pcb->page_table;
+	image = &curr_pcb->image;
+	if(paging_cow_fault(table, fault_addr, error_code) == 0){
+		paging_stats.cow_faults++;
+		return 0;
+	}
+	if((error_code & PF_PRESENT) || fault_addr < OTEMBVIR || fault_addr >= OTTMBVIR){
+		return -1;
+	}
+	index = (fault_addr - OTEMBVIR) >> PAGE_SHIFT;
+	page = fault_addr & BITS20_MASK;
+
+	if(!(table[index] & PTE_DEMAND)){
+		// anonymous memory: zero on first touch
+		if(paging_alloc_user_page(table, page) == 0){
+			return -1;
+		}
+		invalidate_page(page);
+		paging_stats.zero_fills++;
+		return 0;
+	}
+
+	offset = page - LOADADDR;		// file offset of this page
+	paging_stats.demand_faults++;
+	if(offset + PAGE_BYTES <= image->size){
+		block_addr = get_data_block_addr(get_inode(image->inode_index), offset >> PAGE_SHIFT);
+		if(block_addr != 0 && !(block_addr & PAGE_OFFSET_MASK)){
+			paging_map_user_page(table, page, block_addr, PTE_COW | USER | PAGE_PRESENT);
+			invalidate_page(page);
+			paging_stats.pages_mapped++;
+			return 0;
+		}
+	}
+	// private copy; the frame comes zeroed past end of file
+	frame = paging_alloc_user_page(table, page);
+	if(frame == 0){
+		return -1;
+	}
+	invalidate_page(page);
+	count = image->size - offset;
+	if(count > PAGE_BYTES){
+		count = PAGE_BYTES;
+	}
+	if(read_data(image->inode_index, offset, (uint8_t*)frame, count) != count){
+		return -1;
+	}
+	paging_stats.pages_copied++;
+	return 0;
+}
 
 
 // /*
@@ -107,7 +281,7 @@ volatile int32_t addr_saver;
 // 		// if fail
 // 		if(retval!=size) return -1;
 // 		 create PCB && open FDs Note: all ones here are root tasks 
-// 		pcb_t* curr_pcb = (pcb_t *)(EIGHTMB - EIGHTKB * (curr_task_pos + 1));
+// 		pcb_t* curr_pcb = get_pcb(curr_task_pos);
 // 		// set process id
 // 		curr_pcb->process_id = curr_task_pos;
 // 		// set parent_esp and parent_ebp
@@ -252,57 +426,86 @@ int32_t execute(const uint8_t* command)
 	// first check bitmask to get proper location
 	for(i = 0; i < MAXNUMTASK ; i++){	// check bitmap 
 		if(task_bitmap[i]==0){	// have space
-			task_bitmap[i] = 1;	// now have task 
-			curr_task_pos = i;
 			break;
 		}
-		if(i==MAXNUMTASK-1 && runn_task_num==MAXNUMTASK){	// all tasks running
-			//printf("all tasks running.\n");
-			return -1;
-		}
 	}
-	// set paging up
-	int32_t temp;
-	page_dir[PAGEINDEX] = 0;
-	page_dir[PAGEINDEX] = SET_RW_NOT_PRESENT;
-	// re-initialization and then set
-	page_dir[PAGEINDEX] |= PAGE_4MB; 
-	page_dir[PAGEINDEX] |= SET_RW_PRESENT; 
-	page_dir[PAGEINDEX] |= USER;
-	temp = KERNEL_TASK_ADDR + FOURMB * curr_task_pos;		// set physical --> different physical to same virtual
-	temp &= BITS20_MASK;
-	page_dir[PAGEINDEX] |= temp; 
-	enable_paging();
+	if(i == MAXNUMTASK){	// all tasks running
+		return -1;
+	}
+	// caller is the parent; a terminal's first shell has none
+	pcb_t* parent_pcb = get_pcb(curr_task_pos);
+	// pcb and kernel stack share one 8KB aligned block, so PROCESSMASK still finds the pcb
+	pcb_t* curr_pcb = (pcb_t *)frame_alloc(PCB_ORDER);
+	if(curr_pcb == NULL){
+		return -1;
+	}
+	memset(curr_pcb, 0, sizeof(*curr_pcb));
+	// user page goes through the task's own 4KB page table; frames come on demand
+	curr_pcb->page_table = paging_alloc_user_table();
+	if(curr_pcb->page_table == NULL){
+		frame_free((uint32_t)curr_pcb, PCB_ORDER);
+		return -1;
+	}
+	// own page directory: shared (global) kernel part plus this user page
+	curr_pcb->page_dir = paging_alloc_dir(curr_pcb->page_table);
+	if(curr_pcb->page_dir == NULL){
+		paging_free_user_table(curr_pcb->page_table);
+		frame_free((uint32_t)curr_pcb, PCB_ORDER);
+		return -1;
+	}
 
 	/* 4. load file into mem */
 	// find byte 24-27 as virtual addr of first instruction
 	uint32_t addr = 0x0;
 	// below 24, 16, 8 are bitshift in order to get proper eip
 	addr = (buffer[EXEEIP1POS] << 24) | (buffer[EXEEIP2POS] << 16) | (buffer[EXEEIP3POS] << 8) | buffer[EXEEIP4POS];			// eip
-	// copy shell image to 0x00048000 within the page 
-	retval = read_data(dentry.inode_index, 0, (uint8_t *)LOADADDR, size);	// this step should not fail
+	uint64_t load_start = rdtsc();
+	if(exec_load_mode == EXEC_LOAD_DEMAND){
+		demand_program_image(&dentry, curr_pcb, size);
+		retval = size;		// pages come in on first touch
+	}else if(exec_load_mode == EXEC_LOAD_MAP && map_program_image(&dentry, curr_pcb->page_table, size) == 0){
+		retval = size;		// image pages mapped in place
+	}else{
+		// copy shell image to 0x00048000 within the page 
+		retval = copy_program_image(&dentry, curr_pcb->page_table, size);
+	}
+	paging_stats.load_cycles += rdtsc() - load_start;
+	paging_stats.exec_loads++;
 	// if fail
 	if(retval!=size){
 		//printf("mem load fail.\n");
+		paging_free_dir(curr_pcb->page_dir);
+		paging_free_user_table(curr_pcb->page_table);
+		frame_free((uint32_t)curr_pcb, PCB_ORDER);
 		return -1;
 	}
+	// commit: the task now owns position i
+	task_bitmap[i] = 1;
+	task_table[i] = curr_pcb;
+	curr_task_pos = i;
+	load_page_dir(curr_pcb->page_dir);
 	
 	/* 5. create PCB && open FDs */  // at this point. since no open is called. we don't assign shell into file_arr
-	pcb_t* curr_pcb = (pcb_t *)(EIGHTMB - EIGHTKB * (curr_task_pos + 1));
 	// set process id
 	curr_pcb->process_id = curr_task_pos;
 	// set parent_esp and parent_ebp
 	asm volatile("\t movl %%esp,%0" : "=r"(curr_pcb->parent_esp));
 	asm volatile("\t movl %%ebp,%0" : "=r"(curr_pcb->parent_ebp));
 	// set parent_process_id && parent_pcb pointer
-	if(curr_pcb->process_id == 0 && runn_task_num == 0){	// first process as shell
+	if(parent_pcb == NULL){	// first shell of a terminal
 		curr_pcb->parent_process_id = -1; 	// first shell has no parent
 		curr_pcb->parent_pcb = NULL;	// no parent process of shell
 	}else{
-		pcb_t* transition = (pcb_t *)((curr_pcb->parent_esp) & PROCESSMASK);
-		curr_pcb->parent_process_id = transition->process_id; 
-		curr_pcb->parent_pcb = (pcb_t *)((curr_pcb->parent_esp) & PROCESSMASK);
+		curr_pcb->parent_process_id = parent_pcb->process_id; 
+		curr_pcb->parent_pcb = parent_pcb;
 	}
+	// runs in its parent's terminal, or the one being booted
+	curr_pcb->terminal = sched_terminal;
+	sched_set_active(curr_pcb->terminal, curr_task_pos);
+	strncpy((int8_t*)curr_pcb->name, (int8_t*)first_cmd, CMDLENGTH - 1);
+	sched_task_init(curr_pcb);
+	curr_pcb->sc_stats = kzalloc(sizeof(syscall_stats_t));	// counting is skipped if this fails
+	curr_pcb->vidmapped = 0;
 	curr_pcb->running_state = 1;	//update running_state
 	curr_pcb->esp = curr_pcb->ebp = (uint32_t)curr_pcb + EIGHTKB - 4;	//find esp and ebp for the pcb
 	//asm volatile("movl %%cr3, %0" : "=r"(curr_pcb->cr3));
@@ -318,6 +521,9 @@ int32_t execute(const uint8_t* command)
 		curr_pcb->file_array[i].inode = NULL;		
 		curr_pcb->file_array[i].file_pos = 0;		// all file pos is 0
 		curr_pcb->file_array[i].flags = 0;			// all file not in use
+		curr_pcb->file_array[i].block_idx = 0;
+		curr_pcb->file_array[i].block_off = 0;
+		curr_pcb->file_array[i].private_data = NULL;
 	}
 	// set up argbuf; initialize and fill
 	memset(curr_pcb->arg_buffer, 0, sizeof(curr_pcb->arg_buffer)); 
@@ -342,7 +548,7 @@ int32_t execute(const uint8_t* command)
 	/* 7. modify tss and push iret context to stack */		
 	// first modify the tss
 	tss.ss0 = KERNEL_DS;
-    tss.esp0 = EIGHTMB - EIGHTKB * curr_task_pos  - 4;		// from piazza
+    tss.esp0 = (uint32_t)curr_pcb + EIGHTKB - 4;		// top of the task's kernel stack
     // we add the line here (step 1)
     runn_task_num++;
 	/*
@@ -374,6 +580,7 @@ int32_t execute(const uint8_t* command)
 		"pushl $0x002B;"		   	// user_ds = ss		
 		"pushl %%eax;"				// push the stack pointer value we want to have on stack
 		"pushfl;"					// push eflags
+		"orl $0x200, (%%esp);"		// user code runs with interrupts on (IF)
 		"pushl $0x0023;"			// push user_cs
 		"pushl %0;"					// now we should push the desired eip as addr
         : 	
@@ -401,10 +608,25 @@ int32_t halt(uint8_t status)
 	// expand 8-bit arg in BL to 32-bit in exec
 	uint32_t expand_status = (uint32_t)(status & (HIGHMASK));
 
-	pcb_t* curr_pcb = (pcb_t *)(EIGHTMB - EIGHTKB * (curr_task_pos + 1));	// the pcb we need to close after get parent info
+	pcb_t* curr_pcb = get_pcb(curr_task_pos);	// the pcb we need to close after get parent info
+	// let drivers release per-file state (rtc) while this task is still current
+	for(i = 2; i < MAXOPENFILE; i++){
+		if(curr_pcb->file_array[i].flags != 0){
+			close(i);
+		}
+	}
+	// drop this process's pin; the screen may scroll down its vga region again
+	if(curr_pcb->vidmapped){
+		curr_pcb->vidmapped = 0;
+		vga_pin(curr_pcb->terminal, 0);
+	}
 	// first check curr_task: is it first shell?
 	if(curr_task_pos == 0 || runn_task_num == 1 || curr_pcb->parent_process_id == -1 || curr_pcb->process_id == 0){
 		// only shell is running; either ignore or restart shell
+		// a benchmark run is over when its runner, terminal 0's root, exits: stop qemu
+		if((boot_flags & BOOT_BENCH) && curr_pcb->terminal == 0){
+			bootopt_exit(status);
+		}
 		// try to simply return back to user program
 		dentry_t dentry;
 		uint8_t buffer[EXEBUFSIZE];		// buffer to store first 30 bytes
@@ -428,6 +650,7 @@ int32_t halt(uint8_t status)
 			"pushl $0x002B;"		   	// user_ds = ss		
 			"pushl %%eax;"				// push the stack pointer value we want to have on stack
 			"pushfl;"					// push eflags
+			"orl $0x200, (%%esp);"		// user code runs with interrupts on (IF)
 			"pushl $0x0023;"			// push user_cs
 			"pushl %0;"					// now we should push the desired eip as addr
 			"iret;"
@@ -439,26 +662,23 @@ int32_t halt(uint8_t status)
 	}
 
 	/* step 1: restore parent data and clear pcb field*/	
-	task_bitmap[curr_task_pos] = 0;	// indicate not in use
+	uint32_t dead_pos = curr_task_pos;
+	task_bitmap[dead_pos] = 0;	// indicate not in use
+	task_table[dead_pos] = NULL;
 	curr_task_pos = curr_pcb->parent_process_id;	// restore back
 	runn_task_num --;
+	sched_set_active(curr_pcb->terminal, curr_task_pos);	// parent runs for the terminal again
 	
 	/* step 2: restore parent paging */
-	int32_t temp;
-	page_dir[PAGEINDEX] = 0;
-	page_dir[PAGEINDEX] = SET_RW_NOT_PRESENT;
-	// re-initialization and then set
-	page_dir[PAGEINDEX] |= PAGE_4MB; 
-	page_dir[PAGEINDEX] |= SET_RW_PRESENT; 
-	page_dir[PAGEINDEX] |= USER;
-	temp = KERNEL_TASK_ADDR + FOURMB * curr_task_pos;		// now curr_task_pos has been changed
-	temp &= BITS20_MASK;
-	page_dir[PAGEINDEX] |= temp; 
-	enable_paging();
+	// parent's page directory is untouched; now curr_task_pos has been changed
+	load_page_dir(get_pcb(curr_task_pos)->page_dir);
+	// child's address space is unreachable now: give its frames back
+	paging_free_dir(curr_pcb->page_dir);
+	paging_free_user_table(curr_pcb->page_table);
 
 	/* step 3: close any relevant fds */
 	// this step is kind of useless to me this this per-task pcb is decayed
-	tss.esp0 = EIGHTMB - EIGHTKB * curr_task_pos - 4;	// reset tss.esp0; from piazza: 4 is the offset of pos
+	tss.esp0 = (uint32_t)get_pcb(curr_task_pos) + EIGHTKB - 4;	// reset tss.esp0 to the parent's kernel stack top
 	// in case sth bad happen, still try to close fds
 	// just re-initialize; all 8 files
 	for(i = 0; i < MAXOPENFILE; i++){
@@ -466,6 +686,9 @@ int32_t halt(uint8_t status)
 		curr_pcb->file_array[i].inode = NULL;		
 		curr_pcb->file_array[i].file_pos = 0;		// all file pos is 0
 		curr_pcb->file_array[i].flags = 0;			// all file not in use
+		curr_pcb->file_array[i].block_idx = 0;
+		curr_pcb->file_array[i].block_off = 0;
+		curr_pcb->file_array[i].private_data = NULL;
 	}
 
 	curr_pcb->running_state = 0;	//update running_state
@@ -473,8 +696,11 @@ int32_t halt(uint8_t status)
 	/* step 4: jmp to execute return */
 	int32_t esp = curr_pcb->parent_esp;
 	int32_t ebp = curr_pcb->parent_ebp;		
+	kfree(curr_pcb->sc_stats);
 	// in case of memory linkage; memset pcb struct to 0s
 	memset(curr_pcb, 0, sizeof(*curr_pcb));
+	// still running on this kernel stack, but nothing can allocate before the jump below
+	frame_free((uint32_t)curr_pcb, PCB_ORDER);
 
 	if(expand_status == 255){		// exception handling to set the retval of execute to 256 from halt
 		expand_status++;			// note: handled by kernel using halt syscall
@@ -505,12 +731,12 @@ int32_t read(int32_t fd, void* buf, int32_t nbytes)
 	// error handling
 	if(fd < 0
 		 || fd > MAXOPENFILE - 1 
-		 || ((pcb_t *)(EIGHTMB - EIGHTKB * (curr_task_pos + 1)))->file_array[fd].flags == 0 
-		 || ((pcb_t *)(EIGHTMB - EIGHTKB * (curr_task_pos + 1)))->file_array[fd].fop_table == NULL 
-		 || ((pcb_t *)(EIGHTMB - EIGHTKB * (curr_task_pos + 1)))->file_array[fd].fop_table[1] == NULL)			// 1 is read position
+		 || get_pcb(curr_task_pos)->file_array[fd].flags == 0 
+		 || get_pcb(curr_task_pos)->file_array[fd].fop_table == NULL 
+		 || get_pcb(curr_task_pos)->file_array[fd].fop_table[1] == NULL)			// 1 is read position
 		return -1;
 	// syscall read
-	return (*((funcptr)(((pcb_t *)(EIGHTMB - EIGHTKB * (curr_task_pos + 1)))->file_array[fd].fop_table[1])))(fd, buf, nbytes);
+	return (*((funcptr)(get_pcb(curr_task_pos)->file_array[fd].fop_table[1])))(fd, buf, nbytes);
 }
 
 /*
@@ -523,12 +749,12 @@ int32_t write(int32_t fd, const void* buf, int32_t nbytes)
 	// error handling
 	if(fd < 0 
 		|| fd > MAXOPENFILE - 1 
-		|| ((pcb_t *)(EIGHTMB - EIGHTKB * (curr_task_pos + 1)))->file_array[fd].flags == 0 
-		|| ((pcb_t *)(EIGHTMB - EIGHTKB * (curr_task_pos + 1)))->file_array[fd].fop_table == NULL 
-		|| ((pcb_t *)(EIGHTMB - EIGHTKB * (curr_task_pos + 1)))->file_array[fd].fop_table[2] == NULL)			// 2 is write position
+		|| get_pcb(curr_task_pos)->file_array[fd].flags == 0 
+		|| get_pcb(curr_task_pos)->file_array[fd].fop_table == NULL 
+		|| get_pcb(curr_task_pos)->file_array[fd].fop_table[2] == NULL)			// 2 is write position
 		return -1;
 	// syscall write
-	return (*((funcptr)(((pcb_t *)(EIGHTMB - EIGHTKB * (curr_task_pos + 1)))->file_array[fd].fop_table[2])))(fd, buf, nbytes);
+	return (*((funcptr)(get_pcb(curr_task_pos)->file_array[fd].fop_table[2])))(fd, buf, nbytes);
 }
 
 /*
@@ -542,7 +768,7 @@ int32_t open(const uint8_t* filename)
 	cli();
 	dentry_t dentry;
 	int32_t i, available_fd;
-	pcb_t* curr_pcb = (pcb_t *)(EIGHTMB - EIGHTKB * (curr_task_pos + 1));
+	pcb_t* curr_pcb = get_pcb(curr_task_pos);
 	//printf(" in open curr_pcb is 0x%#x\n", curr_pcb);
 	// check filename: first check stdin && stdout
 	if(strncmp((const int8_t*)filename, (const int8_t*)"stdin", 5)==0){		// 5 is char num for stdin
@@ -553,8 +779,14 @@ int32_t open(const uint8_t* filename)
 		// do nothing
 		return 0;
 	}
-	// then check valid
-	if(read_dentry_by_name(filename, &dentry) == -1 || curr_pcb->open_file_num == MAXOPENFILE){
+	// then check valid; the profiler is a kernel file, not in the fs image
+	if(strncmp((const int8_t*)filename, (const int8_t*)PROFILE_NAME, sizeof(PROFILE_NAME)) == 0){
+		dentry.file_type = PROFILE_FILE_TYPE;
+	}
+	else if(read_dentry_by_name(filename, &dentry) == -1){
+		return -1;
+	}
+	if(curr_pcb->open_file_num == MAXOPENFILE){
 		return -1;
 	}
 	// find empty fd and then check file type, allocate; do not need to check 0 and 1 as stdin and stdout
@@ -569,33 +801,44 @@ int32_t open(const uint8_t* filename)
 	}
 	// inode; file_pos; flags; file_names
 	switch(dentry.file_type){
-		case 0:		// as rtc
+		case 0:		// as rtc: every fd gets its own virtual rtc
 			curr_pcb->file_array[available_fd].fop_table = (funcptr *)rtc_fop_table;
-			curr_pcb->file_array[available_fd].inode = (int32_t *)&dentry.inode_index;
-			curr_pcb->file_array[available_fd].file_pos = 0;
-			curr_pcb->file_array[available_fd].flags = 1;
-			strcpy((int8_t*)curr_pcb->file_names[available_fd], (const int8_t*)filename);
-			curr_pcb->open_file_num += 1;
+			curr_pcb->file_array[available_fd].inode = NULL;
+			curr_pcb->file_array[available_fd].private_data = rtc_open(filename);
+			if(curr_pcb->file_array[available_fd].private_data == NULL){
+				return -1;	// out of memory
+			}
 			break;
 		case 1:		// as dir
 			curr_pcb->file_array[available_fd].fop_table = (funcptr *)fs_dir_fop_table;
-			curr_pcb->file_array[available_fd].inode = (int32_t *)&dentry.inode_index;
-			curr_pcb->file_array[available_fd].file_pos = 0;
-			curr_pcb->file_array[available_fd].flags = 1;
-			strcpy((int8_t*)curr_pcb->file_names[available_fd], (const int8_t*)filename);
-			curr_pcb->open_file_num += 1;
+			curr_pcb->file_array[available_fd].inode = NULL;
+			curr_pcb->file_array[available_fd].private_data = NULL;
 			break;
-		case 2:		// as regular file
+		case 2:		// as regular file: resolve inode once here so read never looks up the name again
 			curr_pcb->file_array[available_fd].fop_table = (funcptr *)file_fop_table;
-			curr_pcb->file_array[available_fd].inode = (int32_t *)&dentry.inode_index;
-			curr_pcb->file_array[available_fd].file_pos = 0;
-			curr_pcb->file_array[available_fd].flags = 1;
-			strcpy((int8_t*)curr_pcb->file_names[available_fd], (const int8_t*)filename);
-			curr_pcb->open_file_num += 1;
+			curr_pcb->file_array[available_fd].inode = get_inode(dentry.inode_index);
+			curr_pcb->file_array[available_fd].private_data = NULL;
+			if(curr_pcb->file_array[available_fd].inode == NULL){
+				return -1;	// bad inode index in dentry
+			}
 			break;	
+		case PROFILE_FILE_TYPE:		// as profiler histogram: every open takes a snapshot
+			curr_pcb->file_array[available_fd].fop_table = (funcptr *)profile_fop_table;
+			curr_pcb->file_array[available_fd].inode = NULL;
+			curr_pcb->file_array[available_fd].private_data = profile_open(filename);
+			if(curr_pcb->file_array[available_fd].private_data == NULL){
+				return -1;	// out of memory
+			}
+			break;
 		default:
 			return -1;	// error; failure
 	}
+	curr_pcb->file_array[available_fd].file_pos = 0;
+	curr_pcb->file_array[available_fd].block_idx = 0;
+	curr_pcb->file_array[available_fd].block_off = 0;
+	curr_pcb->file_array[available_fd].flags = 1;
+	strcpy((int8_t*)curr_pcb->file_names[available_fd], (const int8_t*)filename);
+	curr_pcb->open_file_num += 1;
 	return available_fd;	// success open file
 }
 
@@ -607,7 +850,7 @@ int32_t open(const uint8_t* filename)
 int32_t close(int32_t fd)
 {
 	cli();
-	pcb_t* curr_pcb = (pcb_t *)(EIGHTMB - EIGHTKB * (curr_task_pos + 1));
+	pcb_t* curr_pcb = get_pcb(curr_task_pos);
 	// check vaild: should not close 0 and 1
 	if(fd < 2 || fd > MAXOPENFILE - 1 || curr_pcb->open_file_num <= 2){		// at least 2 are open
 		return -1;
@@ -620,6 +863,9 @@ int32_t close(int32_t fd)
 	curr_pcb->file_array[fd].file_pos = 0;
 	curr_pcb->file_array[fd].fop_table = NULL;
 	curr_pcb->file_array[fd].inode = NULL;
+	curr_pcb->file_array[fd].block_idx = 0;
+	curr_pcb->file_array[fd].block_off = 0;
+	curr_pcb->file_array[fd].private_data = NULL;
 	curr_pcb->open_file_num -= 1;
 	return 0;
 }
@@ -632,7 +878,7 @@ int32_t close(int32_t fd)
 int32_t getargs(uint8_t* buf, int32_t nbytes)
 {
 	cli();
-	pcb_t* curr_pcb = (pcb_t *)(EIGHTMB - EIGHTKB * (curr_task_pos + 1));
+	pcb_t* curr_pcb = get_pcb(curr_task_pos);
 	// check valid
 	if(buf == NULL || nbytes == 0 || strlen((const int8_t*)curr_pcb->arg_buffer) > nbytes || strlen((const int8_t*)(curr_pcb->arg_buffer)) == 0){
 		return -1;
@@ -653,20 +899,17 @@ int32_t vidmap(uint8_t** screen_start)
 	if(screen_start == NULL || screen_start >= (uint8_t**)OTTMBVIR || screen_start < (uint8_t**)OTEMBVIR){
 		return -1;
 	}
-	// set paging up
-	uint32_t temp = 0;
-	// initialization: to be mapped to 136MB virtual address
-	page_dir[VIDMAPNEW] = 0;
-	page_dir[VIDMAPNEW] = SET_RW_NOT_PRESENT;
-	// set
-	page_dir[VIDMAPNEW] |= SET_RW_PRESENT; 
-	page_dir[VIDMAPNEW] |= USER;
-	temp = (uint32_t)page_tab;		// set physical --> different physical to same virtual
-	temp &= BITS20_MASK;
-	page_dir[VIDMAPNEW] |= temp; 
-	// set tab entry: default entry 0
-	page_tab[0] = VIDEO | SET_RW_PRESENT | USER;
-	enable_paging();
+	pcb_t* pcb = get_pcb(curr_task_pos);
+	// set paging up in this process's own directory: 136MB -> its terminal's vidmap_tab
+	paging_set_pde(pcb->page_dir, OTSMBVIR, ((uint32_t)vidmap_tab[pcb->terminal] & BITS20_MASK) | SET_RW_PRESENT | USER);
+	// set tab entry: default entry 0; invalidates just that page
+	// the terminal's vga region, shown or not; its screen is moved to the page start
+	// and kept there until the process halts
+	if(!pcb->vidmapped){
+		pcb->vidmapped = 1;
+		vga_pin(pcb->terminal, 1);
+	}
+	paging_map_user_video(pcb->terminal, video_buf_addr[pcb->terminal]);
 	// return 
 	*screen_start = (uint8_t*)OTSMBVIR;
 	return OTSMBVIR;
@@ -694,6 +937,66 @@ int32_t sigreturn(void)
 	return -1;
 }
 
+/*
+ * int32_t stats(int32_t kind, void* buf, int32_t nbytes);
+ * copy a block of kernel statistics into a user buffer
+ * return value: number of bytes copied; -1 for a bad kind or buffer
+ */
+int32_t stats(int32_t kind, void* buf, int32_t nbytes)
+{
+	void* src;
+	int32_t size;
+
+	// check valid: buffer must sit inside the user page
+	if(buf == NULL || nbytes <= 0 || (uint32_t)buf < OTEMBVIR || (uint32_t)nbytes > OTTMBVIR - (uint32_t)buf){
+		return -1;
+	}
+	switch(kind){
+		case STATS_PAGING:
+			src = &paging_stats;
+			size = sizeof(paging_stats);
+			break;
+		case STATS_FRAMES:
+			src = &frame_stats;
+			size = sizeof(frame_stats);
+			break;
+		case STATS_KMALLOC:
+			src = &kmalloc_stats;
+			size = sizeof(kmalloc_stats);
+			break;
+		case STATS_TLB:
+			src = &tlb_stats;
+			size = sizeof(tlb_stats);
+			break;
+		case STATS_SCHED:
+			src = &sched_stats;
+			size = sizeof(sched_stats);
+			break;
+		case STATS_SERIAL:
+			src = &serial_stats;
+			size = sizeof(serial_stats);
+			break;
+		case STATS_TIMER:
+			src = &pit_stats;
+			size = sizeof(pit_stats);
+			break;
+		case STATS_RTC:
+			src = &rtc_stats;
+			size = sizeof(rtc_stats);
+			break;
+		case STATS_PROC:
+			// one record per live process, as many as fit
+			return sched_proc_stats((proc_stats_t*)buf, nbytes / sizeof(proc_stats_t)) * sizeof(proc_stats_t);
+		default:
+			return -1;
+	}
+	if(size > nbytes){
+		size = nbytes;
+	}
+	memcpy(buf, src, size);
+	return size;
+}
+
 /*
  * debug function process_dump to
  * give information of current task
@@ -710,14 +1013,20 @@ void process_dump(pcb_t* pcb, uint32_t addr)
 
 /*
  * wapper function for regular file read
- * read regular file
+ * read regular file: goes straight to the data blocks through the
+ * inode and block cursor cached in the file node at open()
  */
 int32_t filesys_read(int32_t fd, void* buf, int32_t nbytes)		
 {
-	pcb_t* curr_pcb = (pcb_t *)(EIGHTMB - EIGHTKB * (curr_task_pos + 1));
-	//printf("fname is: %s\n", *curr_pcb->file_names[fd]);
-	int32_t byte_readed_num = filesys_read_helper((const uint8_t*)curr_pcb->file_names[fd], curr_pcb->file_array[fd].file_pos, buf, nbytes);
-	curr_pcb->file_array[fd].file_pos += byte_readed_num;
+	pcb_t* curr_pcb = get_pcb(curr_task_pos);
+	file_node_t* file = &curr_pcb->file_array[fd];
+	if(nbytes < 0){
+		return -1;
+	}
+	int32_t byte_readed_num = read_data_cursor(file->inode, &file->block_idx, &file->block_off, (uint8_t*)buf, nbytes);
+	if(byte_readed_num > 0){
+		file->file_pos += byte_readed_num;
+	}
 	return byte_readed_num;
 }
 
@@ -727,21 +1036,117 @@ int32_t filesys_read(int32_t fd, void* buf, int32_t nbytes)
  */
 int32_t fs_dir_read(int32_t fd, void* buf, int32_t nbytes)	// in dir read, only the filename is useful
 {
-	pcb_t* curr_pcb = (pcb_t *)(EIGHTMB - EIGHTKB * (curr_task_pos + 1));
+	pcb_t* curr_pcb = get_pcb(curr_task_pos);
 	return fs_dir_ls_read_helper((const uint8_t*)curr_pcb->file_names[fd], curr_pcb->file_array[fd].file_pos, buf, nbytes);
 }
 
 /*
-*	set all pcb to 0
+*	set all task positions free
 */
 void pcb_init()
 {
 	int i;
 	for(i=0;i<MAXNUMTASK;i++)
 	{
-		pcb_t* temp_pcb = (pcb_t *)(EIGHTMB - EIGHTKB * (i + 1));
-		memset(temp_pcb, 0, sizeof(*temp_pcb));
+		task_table[i] = NULL;
+		task_bitmap[i] = 0;
 	} 
+	curr_task_pos = NO_TASK;
 }
 
+/*
+ * int32_t gettime(uint64_t* ns);
+ * store the monotonic clock, nanoseconds since boot, in *ns. Programs can
+ * read the same clock without a trap from the page at TIME_PAGE_VIRT.
+ * return value: 0; -1 for a bad buffer
+ */
+int32_t gettime(uint64_t* ns)
+{
+	// check valid: the 8 bytes must sit inside the user page
+	if((uint32_t)ns < OTEMBVIR || sizeof(uint64_t) > OTTMBVIR - (uint32_t)ns){
+		return -1;
+	}
+	*ns = clock_ns();
+	return 0;
+}
 
+/*
+ * void syscall_stat_add(syscall_stat_t* st, uint64_t cycles, int32_t retval);
+ * add one call to a system call's counters
+ * return value: none
+ */
+static void syscall_stat_add(syscall_stat_t* st, uint64_t cycles, int32_t retval)
+{
+	uint32_t c = (cycles >> 32) ? 0xFFFFFFFF : (uint32_t)cycles;
+	uint32_t bucket = 0;
+
+	if(c != 0){
+		asm("bsrl %1, %0" : "=r"(bucket) : "rm"(c));
+	}
+	st->calls++;
+	if(retval < 0){
+		st->errors++;
+	}
+	st->cycles += cycles;
+	if(c > st->max_cycles){
+		st->max_cycles = c;
+	}
+	st->hist[bucket]++;
+}
+
+/*
+ * int32_t syscall_account(int32_t retval, uint64_t start, uint32_t num);
+ * called by the system call entry in syscallasm.S after a call returns,
+ * with interrupts off. Charges the time since start to the system-wide
+ * counters and to the calling process. Execute is charged to the parent
+ * when its child halts; halt itself never comes back here.
+ * return value: retval, handed back to the user
+ */
+int32_t syscall_account(int32_t retval, uint64_t start, uint32_t num)
+{
+	uint64_t cycles = rdtsc() - start;
+	pcb_t* pcb = get_pcb(curr_task_pos);
+
+	syscall_stat_add(&syscall_stats.sys[num - 1], cycles, retval);
+	if(pcb != NULL && pcb->sc_stats != NULL){
+		syscall_stat_add(&pcb->sc_stats->sys[num - 1], cycles, retval);
+	}
+	return retval;
+}
+
+/*
+ * int32_t sysstats(int32_t pid, void* buf, int32_t nbytes);
+ * copy the syscall_stats_t of one process, or the system-wide one for
+ * pid SYSSTATS_GLOBAL, into a user buffer
+ * return value: number of bytes copied; -1 for a bad pid or buffer
+ */
+int32_t sysstats(int32_t pid, void* buf, int32_t nbytes)
+{
+	syscall_stats_t* src;
+	pcb_t* pcb;
+	uint32_t flags;
+	int32_t size = sizeof(syscall_stats_t);
+
+	// check valid: buffer must sit inside the user page
+	if(buf == NULL || nbytes <= 0 || (uint32_t)buf < OTEMBVIR || (uint32_t)nbytes > OTTMBVIR - (uint32_t)buf){
+		return -1;
+	}
+	if(size > nbytes){
+		size = nbytes;
+	}
+	// the process must not halt in the middle of the copy
+	cli_and_save(flags);
+	if(pid == SYSSTATS_GLOBAL){
+		src = &syscall_stats;
+	}else{
+		pcb = get_pcb(pid);
+		if(pcb == NULL || pcb->sc_stats == NULL){
+			restore_flags(flags);
+			return -1;
+		}
+		src = pcb->sc_stats;
+	}
+	memcpy(buf, src, size);
+	restore_flags(flags);
+	return size;
+}
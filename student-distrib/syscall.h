@@ -8,11 +8,13 @@
 #include "x86_desc.h"
 #include "lib.h"
 #include "i8259.h"
+#include "wait.h"
+#include "sched_stats.h"
 
 /* defined constants */
 #define HIGHMASK			0x000000FF
 #define FOPTABLESIZE		4		// also serve as mgc checker size
-#define MAXNUMTASK			6
+#define MAXNUMTASK			PROC_MAX	// size of the pid table; memory is the real limit
 #define MAXOPENFILE			8
 #define CMDLENGTH			20
 #define EXEEIP1POS			27
@@ -37,6 +39,43 @@
 #define OTSMBVIR			0x08800000
 #define FOURMB				0x00400000
 #define PROCESSMASK			0xFFFFE000
+#define EXEC_LOAD_COPY		0			// copy the whole image into the task page
+#define EXEC_LOAD_MAP		1			// map image pages from the fs image, copy on write
+#define EXEC_LOAD_DEMAND	2			// load image pages on first touch
+#define STATS_PAGING		0			// stats() kind: paging_stats_t
+#define STATS_FRAMES		1			// stats() kind: frame_stats_t
+#define STATS_KMALLOC		2			// stats() kind: kmalloc_stats_t
+#define STATS_TLB			3			// stats() kind: tlb_stats_t
+#define STATS_SCHED			4			// stats() kind: sched_stats_t
+#define STATS_PROC			5			// stats() kind: proc_stats_t of every live process
+#define STATS_RTC			6			// stats() kind: rtc_stats_t
+#define STATS_TIMER			7			// stats() kind: pit_stats_t
+#define STATS_SERIAL		8			// stats() kind: serial_stats_t
+#define SYSCALL_COUNT		13			// system calls 1..13
+#define SYSCALL_HIST_BUCKETS	32		// log2 latency buckets: bucket i counts [2^i, 2^(i+1)) cycles
+#define SYSSTATS_GLOBAL		-1			// sysstats() pid for the system-wide counters
+#define PCB_ORDER			1			// pcb + kernel stack: one 8KB frame block
+#define PAGE_BYTES			0x00001000
+#define PAGE_OFFSET_MASK	0x00000FFF
+#define NO_TASK				0xFF		// curr_task_pos when the kernel itself runs
+
+/* one system call's counters */
+typedef struct syscall_stat_t_struct
+{
+	uint32_t calls;
+	uint32_t errors;						// calls that returned a negative value
+	uint32_t max_cycles;
+	uint64_t cycles;						// tsc cycles from the int 0x80 entry to the return
+	uint32_t hist[SYSCALL_HIST_BUCKETS];	// calls by log2 of their cycles
+}syscall_stat_t;
+
+/* counters of every system call, indexed by number - 1 */
+typedef struct syscall_stats_t_struct
+{
+	syscall_stat_t sys[SYSCALL_COUNT];
+}syscall_stats_t;
+
+extern syscall_stats_t syscall_stats;
 
 /* function pointer typedef */
 typedef int32_t (*funcptr)();
@@ -44,11 +83,37 @@ typedef int32_t (*funcptr)();
 typedef struct file_node_t_struct			// fd as index to identify open files
 {
 	funcptr* fop_table;		// jump table contains open, close, read and write 
-	int32_t* inode;			// pointer to inode for the file
+	struct inode_t_struct* inode;	// inode resolved at open; NULL for non-regular files
 	int32_t  file_pos;		// where user currently reading from in file (read update)
 	int32_t  flags;			// in use
+	uint32_t block_idx;		// cached index into inode DATA_BLOCKS of next read
+	uint32_t block_off;		// cached byte offset inside that data block
+	void* private_data;		// driver state of this open file (rtc), NULL otherwise
 }file_node_t;
 
+/* program image backing the demand-paged pages of a task */
+typedef struct exec_image_t_struct
+{
+	uint32_t inode_index;
+	uint32_t size;
+}exec_image_t;
+
+/* scheduler state of a process */
+typedef struct sched_info_t_struct
+{
+	struct pcb_t_struct* next;		// run queue or wait queue links
+	struct pcb_t_struct* prev;
+	int32_t level;					// run queue it is on; -1 while running or waiting
+	wait_queue_t* wait;				// wait queue it sleeps on, NULL if awake
+	uint32_t priority;				// 0 is highest; sinks as slices run out
+	uint32_t slice_left;			// ticks left of the current slice
+	uint32_t ticks;					// ticks charged to this process
+	uint32_t dispatches;			// times switched to
+	uint32_t expired;				// slices used up, one demotion each
+	uint32_t credits;				// priority given back for terminal input
+	uint32_t sleeps;				// times blocked on a wait queue
+}sched_info_t;
+
 /* pcb (process control block struct) */
 typedef struct pcb_t_struct
 {
@@ -64,6 +129,14 @@ typedef struct pcb_t_struct
 	int32_t esp;	//for scheduling
 	int32_t ebp;	//for scheduling
 	struct pcb_t_struct* parent_pcb;
+	uint32_t* page_dir;			// this process's page directory
+	uint32_t* page_table;		// 4KB page table of the 128MB user page
+	exec_image_t image;			// program file behind demand-paged pages
+	int32_t terminal;			// terminal this process belongs to
+	uint8_t name[CMDLENGTH];	// program name
+	sched_info_t sched;			// run queue state and counters
+	syscall_stats_t* sc_stats;	// this process's system call counters; NULL if out of memory
+	int32_t vidmapped;			// holds a vga_pin on its terminal
 }pcb_t;
 
 /* boot function */
@@ -99,12 +172,30 @@ int32_t set_handler(int32_t signum, void* handler_address);
 /* syscall sigreturn */
 int32_t sigreturn(void);
 
+/* syscall stats */
+int32_t stats(int32_t kind, void* buf, int32_t nbytes);
+
+/* syscall gettime */
+int32_t gettime(uint64_t* ns);
+
+/* syscall sysstats */
+int32_t sysstats(int32_t pid, void* buf, int32_t nbytes);
+
+/* system call exit hook in syscallasm.S: count and time the call */
+int32_t syscall_account(int32_t retval, uint64_t start, uint32_t num);
+
 /* syscall file read helper */
 int32_t filesys_read(int32_t fd, void* buf, int32_t nbytes);
 
 /* syscall dir read helper */
 int32_t fs_dir_read(int32_t fd, void* buf, int32_t nbytes);
 
+/* pcb of a task position */
+pcb_t* get_pcb(uint32_t pos);
+
+/* resolve a page fault on the current task's program image */
+int32_t program_page_fault(uint32_t fault_addr, uint32_t error_code);
+
 /* debug info dump helper */
 void process_dump(pcb_t* pcb, uint32_t addr);
 
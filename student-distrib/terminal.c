@@ -5,6 +5,9 @@
 
 
 #include "terminal.h"
+#include "sche.h"
+#include "bootopt.h"
+#include "kmalloc.h"
 
 int8_t* interface = "391OS> ";
 
@@ -14,18 +17,16 @@ int8_t* text_mode_interface = "[[==================<text editing mode>==<history
 
 extern int first_scroll_indicator;
 extern int enter_flag;
-extern volatile int cross_enter_flag;
 // extern uint8_t keyboard_buffer[128];
 
-uint8_t ter_read_buffer[BUF_SIZE] = {0};
-uint32_t ter_read_buf_size;
-uint32_t ter_read_indicator;
-extern uint8_t keyboard_buffer[BUF_SIZE];
+extern uint8_t* keyboard_buffer;
+extern volatile uint8_t kb_buffer_position;
 
 
 ter_info terminal_array[TERMINAL_MAXNUM];
 
-// Addresses of 3 video memory buffer 
+// Addresses of 3 video memory buffer: every terminal draws in its own
+// part of the vga text memory, shown or not
 uint32_t video_buf_addr[TERMINAL_NUM] = {VIDEO_BUF_0, VIDEO_BUF_1, VIDEO_BUF_2};
 
 uint32_t current_terminal_idx;	// should initialize in init 3 shells
@@ -40,25 +41,33 @@ void terminal_init()
 {
 	int i,j;
 	current_terminal_idx = 0;
+	console_init();
 	//initialize all 3 structs
-	for(i=0;i<MAX_TER_INDEX;i++)
+	for(i=0;i<TERMINAL_MAXNUM;i++)
 	{
 		terminal_array[i].terminal_index = i;
-		for(j=0;j<4096;j++)
-		{
-			//clear screen buffer
-			terminal_array[i].screen_buffer[j] = '\0';
-		}
+		//no scrollback until the terminal boots
+		terminal_array[i].history.lines = NULL;
+		terminal_array[i].history.head = 0;
+		terminal_array[i].history.count = 0;
+		terminal_array[i].history.view = 0;
 		for(j=0;j<BUF_SIZE;j++)
 		{
 			//clear terminal read buffer and keyboard buffer
 			terminal_array[i].keyboard_buffer[j] = '\0';
-			terminal_array[i].read_buffer[j] = '\0';
 		}
 		//clear cursor position and set all terminal to inactive
 		terminal_array[i].cursor_pos_x = 0;
 		terminal_array[i].cursor_pos_y = 0;
-		terminal_array[i].terminal_state = 0;
+		terminal_array[i].terminal_state = TERM_INACTIVE;
+		terminal_array[i].active_pid = -1;
+		terminal_array[i].kb_position = 0;
+		terminal_array[i].in_head = 0;
+		terminal_array[i].in_tail = 0;
+		terminal_array[i].lines_in = 0;
+		terminal_array[i].lines_out = 0;
+		terminal_array[i].read_wait.head = NULL;
+		terminal_array[i].read_wait.tail = NULL;
 	}
 	//boot first terminal
 	terminal_boot(0);
@@ -68,30 +77,23 @@ void terminal_init()
  *  terminal_boot()
  *	Input: terminal index
  *	Output: none
- *	Function: boot a new terminal shell
+ *	Function: boot a new terminal shell; runs with interrupts off from boot
+ *	or from the scheduler tick, and only returns if the shell cannot start
  */
 void terminal_boot(int index)
 {
-	reset();
-	printf("terminal %d booted.\n", index+1);
-	terminal_array[index].terminal_state = 1;	//set terminal to active
-	//setup corresponding video buffer page
-	int video_addr;
-	video_addr = video_buf_addr[index];
-	video_addr >>= 12;
-	page_tab[video_addr] |= USER_RW_PRE;
-	page_tab[video_addr] |= video_buf_addr[index];
-
-	uint8_t shell[100] = "shell";
-	current_terminal_idx = index;
-	send_eoi(IRQ1);
-	// re-able interrupts
-	sti();
-	//boot shell
-	int retval = execute(shell);
+	if(index == current_terminal_idx){
+		reset();
+		printf("terminal %d booted.\n", index+1);
+	}
+	terminal_array[index].terminal_state = TERM_ACTIVE;	//set terminal to active
+	//scrollback ring, kept for good; the terminal works without one if memory is short
+	if(terminal_array[index].history.lines == NULL)
+		terminal_array[index].history.lines = kboot_alloc(SCROLLBACK_LINES * NUM_COLS * 2);
+
+	//boot shell, or the benchmark runner when booted with "bench"
+	int retval = execute(bootopt_program(index));
 	if(retval == -1){	// if error: print in kernel
-		sti();
-		send_eoi(0);
 		printf("return from first shell : -1. \n");
 	}
 }
@@ -103,37 +105,37 @@ int32_t terminal_open(const uint8_t* filename){
 	return 0;
 }
 
-/* returns the number of bytes read
+/* returns the number of bytes read: one typed line up to and including
+ * its '\n', or the first nbytes of it (the rest comes with the next read)
  * Note: terminal read only work in normal mode
  *
  */
 int32_t terminal_read(int32_t fd, void* buf, int32_t nbytes){ 	//nbytes is buffer size
 	
-	ter_read_indicator = 1;
-	int i, ret;
+	// lines typed on a terminal only go to that terminal's reader
+	ter_info* ter = &terminal_array[sched_terminal];
+	uint8_t* buffer = (uint8_t *)buf;
+	uint8_t c;
+	int32_t i;
 	if(enter_flag == 0){
 		// we can have terminal_read
-		// wait enter
-		while(cross_enter_flag == 0);
-		// not zero; reset
-		cross_enter_flag = 0;
+		// sleep until a whole line is queued; the keyboard interrupt wakes us
 		cli();		// mask all interrupts
+		while(ter->lines_in == ter->lines_out)
+			sched_sleep(&ter->read_wait);
+		sti();
 
-		uint8_t* buffer = (uint8_t *)buf;
-
-		for (i = 0; (i < nbytes) && (i < BUF_SIZE) && ter_read_buffer[i] != '\0'; i++) {
-			buffer[i] = ter_read_buffer[i];
+		// only this reader moves in_tail, so taking bytes needs no lock
+		for(i = 0; i < nbytes; ){
+			c = ter->input[ter->in_tail & (TERM_INPUT_SIZE - 1)];
+			ter->in_tail++;
+			buffer[i++] = c;
+			if(c == '\n'){
+				ter->lines_out++;
+				break;
+			}
 		}
-		buffer[i+1] = '\0';
-		
-		if(ter_read_buf_size > nbytes){
-			ret = nbytes;
-		}else{
-			ret = i;
-		}
-		sti();
-		ter_read_indicator = 0;
-		return ret;
+		return i;
 	}else{
 		return -1;
 	}
@@ -146,12 +148,10 @@ int32_t terminal_read(int32_t fd, void* buf, int32_t nbytes){ 	//nbytes is buffe
 int32_t terminal_write(int32_t fd, const void* buf, int32_t nbytes){
 	int32_t ret;
 	cli();
-	int i;
 	uint8_t* buffer = (uint8_t *)buf;
-	for(i = 0; i < nbytes; i++){
-		putc(buffer[i]);
-	}
-	ret = i + 1;
+	putc_span(buffer, nbytes);
+	debugcon_write(buffer, nbytes);
+	ret = ((nbytes > 0) ? nbytes : 0) + 1;
 	sti();
 	return ret;
 }
@@ -180,76 +180,116 @@ int32_t terminal_switch(int32_t terminal_idx)
 	if(terminal_idx == current_terminal_idx)
 		return 0;
 
-	int i;
-	//save keyboard buffer and terminal read buffer
-	for(i=0;i<BUF_SIZE;i++)
-	{
-		terminal_array[current_terminal_idx].keyboard_buffer[i] = keyboard_buffer[i];
-		terminal_array[current_terminal_idx].read_buffer[i] = ter_read_buffer[i];
-	}
+	//leave the scrollback view of the terminal being hidden
+	terminal_scroll_live();
+	//the typed line stays in the terminal's struct; keep its length
+	terminal_array[current_terminal_idx].kb_position = kb_buffer_position;
 
-	//save current cursor position
-	terminal_array[current_terminal_idx].cursor_pos_x = x_pos();
-	terminal_array[current_terminal_idx].cursor_pos_y = y_pos();
-	// save current terminal contents back into buffer
-	memcpy((void*)video_buf_addr[current_terminal_idx], (void*)VIDEO, VIDEO_BUF_SIZE);
-
-
-	// this part is able to remap user video to a different display mem regardless of next one booted or not
-	uint32_t new_video_physical = video_buf_addr[current_terminal_idx];
-	uint32_t temp = 0;
-	// initialization: to be mapped to 136MB virtual address
-	page_dir[VIDMAPNEW] = 0;
-	page_dir[VIDMAPNEW] = SET_RW_NOT_PRESENT;
-	// set
-	page_dir[VIDMAPNEW] |= SET_RW_PRESENT; 
-	page_dir[VIDMAPNEW] |= USER;
-	temp = (uint32_t)page_tab;		// set physical --> different physical to same virtual
-	temp &= BITS20_MASK;
-	page_dir[VIDMAPNEW] |= temp; 
-	// set tab entry: default entry 0
-	page_tab[0] = new_video_physical | SET_RW_PRESENT | USER;
-	flush_tlb();
-	//clean the screen
-	reset();
-
-
-	//check if the terminal is active, boot one if not
-	if(terminal_array[terminal_idx].terminal_state == 0)
+	//check if the terminal is active, have the scheduler boot one if not
+	if(terminal_array[terminal_idx].terminal_state == TERM_INACTIVE)
 	{
-		terminal_boot(terminal_idx);
+		uint32_t flags;
+		cli_and_save(flags);		// the tick reprograms the pit too
+		terminal_array[terminal_idx].terminal_state = TERM_BOOTING;
+		pit_periodic();		// the boot happens on the next tick; make sure one comes
+		restore_flags(flags);
 	}
-	//restore keyboard buffer and terminal read buffer
-	for(i=0;i<BUF_SIZE;i++)
-	{
-		keyboard_buffer[i] = terminal_array[terminal_idx].keyboard_buffer[i];
-		ter_read_buffer[i] = terminal_array[terminal_idx].read_buffer[i];
-	}
-	//restore terminal contents into buffer
-	memcpy((void*)VIDEO, (void*)video_buf_addr[terminal_idx], VIDEO_BUF_SIZE);
+	//keys now edit the new terminal's line
+	keyboard_buffer = (uint8_t*)terminal_array[terminal_idx].keyboard_buffer;
+	kb_buffer_position = terminal_array[terminal_idx].kb_position;
 	//vary terminal index
 	current_terminal_idx = terminal_idx;
-	//update screen_x, screen_y and cursor position
-	update_x(terminal_array[current_terminal_idx].cursor_pos_x);
-	update_y(terminal_array[current_terminal_idx].cursor_pos_y);
-	update_cursor(terminal_array[current_terminal_idx].cursor_pos_y,terminal_array[current_terminal_idx].cursor_pos_x);
+	//the screen and cursor are kept in the terminal's vga region: just show it
+	//(vidmap pages point at the regions too, so nothing is remapped)
+	console_show(terminal_idx);
 	//send_eoi(1);
 	return 0;
 }
 
 
+/*
+ *  terminal_history_push()
+ *	Input: index -- terminal
+ *	       row -- NUM_COLS char+attribute words about to scroll off
+ *	Output: none
+ *	Function: append the row to the terminal's scrollback ring, dropping
+ *	the oldest row once it is full. A terminal being viewed keeps showing
+ *	the same rows.
+ */
+void terminal_history_push(int32_t index, const uint16_t* row)
+{
+	scrollback_t* sb = &terminal_array[index].history;
+
+	if(sb->lines == NULL)
+		return;
+	memcpy(sb->lines + sb->head * NUM_COLS, row, NUM_COLS * 2);
+	if(++sb->head == SCROLLBACK_LINES)
+		sb->head = 0;
+	if(sb->count < SCROLLBACK_LINES)
+		sb->count++;
+	if(sb->view != 0 && sb->view < sb->count)
+		sb->view++;
+}
 
+/*
+ *  terminal_scroll()
+ *	Input: rows -- rows to move the view back, negative to move forward
+ *	Output: none
+ *	Function: show the shown terminal's output from before the live
+ *	screen. The view is drawn from the scrollback ring and the live screen
+ *	into VGA_VIEW_AREA and the crtc is pointed there, so the running
+ *	program carries on drawing on its own screen out of sight. Back at 0
+ *	the crtc just shows the live screen again.
+ */
+void terminal_scroll(int32_t rows)
+{
+	scrollback_t* sb = &terminal_array[current_terminal_idx].history;
+	uint16_t* live = (uint16_t*)vga_screen(current_terminal_idx);
+	uint16_t* screen = (uint16_t*)VGA_VIEW_AREA;
+	const uint16_t* src;
+	int32_t view;
+	uint32_t first, line, r;
+
+	view = (int32_t)sb->view + rows;
+	if(view < 0)
+		view = 0;
+	if(view > (int32_t)sb->count)
+		view = sb->count;
+	if(view == (int32_t)sb->view)
+		return;
+
+	sb->view = view;
+	if(view == 0){
+		vga_view(NULL);
+		return;
+	}
 
+	// rows count - view .. count - view + NUM_ROWS of history followed by the live screen
+	first = sb->count - view;
+	for(r = 0; r < NUM_ROWS; r++){
+		if(first + r < sb->count){
+			line = sb->head + SCROLLBACK_LINES - sb->count + first + r;
+			if(line >= SCROLLBACK_LINES)
+				line -= SCROLLBACK_LINES;
+			src = sb->lines + line * NUM_COLS;
+		}else{
+			src = live + (first + r - sb->count) * NUM_COLS;
+		}
+		memcpy(screen + r * NUM_COLS, src, NUM_COLS * 2);
+	}
+	vga_view(screen);
+}
 
+/*
+ *  terminal_scroll_live()
+ *	Input: none
+ *	Output: none
+ *	Function: leave the scrollback view of the shown terminal, if any
+ */
+void terminal_scroll_live()
+{
+	scrollback_t* sb = &terminal_array[current_terminal_idx].history;
 
-
-
-
-
-
-
-
-
-
-
-
+	if(sb->view != 0)
+		terminal_scroll(-(int32_t)sb->view);
+}
@@ -8,6 +8,7 @@
 #include "x86_desc.h"
 #include "lib.h"
 #include "i8259.h"
+#include "wait.h"
 #include "keyboard.h"
 #include "syscall.h"
 #include "paging.h"
@@ -23,25 +24,58 @@
 #define MAX_TERMINAL_IDX   2
 #define TERMINAL_NUM       3
 #define BUF_SIZE		   128
-#define VIDEO_BUF_SIZE     4096
 
 #define USER_RW_PRE     0x07
-#define VIDEO_BUF_0     0xB9000
+/* each terminal's part of the vga text memory, VGA_REGION_SIZE apart */
+#define VIDEO_BUF_0     0xB8000
 #define VIDEO_BUF_1     0xBA000
-#define VIDEO_BUF_2     0xBB000
+#define VIDEO_BUF_2     0xBC000
+#define TERM_INPUT_SIZE 512		/* typed-ahead input per terminal, power of 2 */
+#define SCREEN_BYTES    (NUM_ROWS * NUM_COLS * 2)	/* one screen of char+attribute words */
+
+/* scrollback: rows that scroll off the top, kept in a 512KB kmalloc block */
+#define SCROLLBACK_LINES    3200
+#define SCROLLBACK_PAGE     (NUM_ROWS - 1)		/* rows moved by shift+pgup/pgdn */
+
+/* terminal_state values */
+#define TERM_INACTIVE   0
+#define TERM_ACTIVE     1
+#define TERM_BOOTING    2       // shown, shell started by the next tick
+
+/* ring of the rows scrolled off a terminal, oldest first */
+typedef struct scrollback_struct
+{
+	uint16_t* lines;		// SCROLLBACK_LINES rows of NUM_COLS char+attribute words; NULL if none
+	uint32_t head;			// row the next line goes to
+	uint32_t count;			// rows kept
+	uint32_t view;			// rows scrolled back from the live screen, 0 when live
+}scrollback_t;
+
+extern uint32_t video_buf_addr[TERMINAL_NUM];
+extern uint32_t current_terminal_idx;
 
 typedef	struct terminal_info_struct
 {
 	int8_t terminal_index;
-	int8_t screen_buffer[4096];
-	int8_t keyboard_buffer[BUF_SIZE];
-	int8_t read_buffer[BUF_SIZE];
+	scrollback_t history;
+	int8_t keyboard_buffer[BUF_SIZE];	// line being typed
+	uint32_t kb_position;			// its length while the terminal is not shown
+	/* typed lines waiting for terminal_read; single producer (keyboard_drain,
+	 * publishing with interrupts off) and single consumer (the terminal's reader), no lock */
+	uint8_t input[TERM_INPUT_SIZE];
+	volatile uint32_t in_head;		// moved by the keyboard only
+	volatile uint32_t in_tail;		// moved by terminal_read only
+	volatile uint32_t lines_in;		// lines queued, counted by the keyboard
+	volatile uint32_t lines_out;	// lines taken, counted by terminal_read
 	int8_t cursor_pos_x;
 	int8_t cursor_pos_y;
 	int32_t terminal_state;
-	//pcb_t * process;
+	int32_t active_pid;				// task position the scheduler runs for this terminal, -1 for none
+	wait_queue_t read_wait;			// readers sleeping until a line is queued
 }ter_info;
 
+extern ter_info terminal_array[TERMINAL_MAXNUM];
+
 
 /* Initialize terminal */
 void terminal_init();
@@ -64,6 +98,15 @@ int32_t terminal_close(int32_t fd);
 /* switch to other terminal */
 int32_t terminal_switch(int32_t terminal_num);
 
+/* Keep a row scrolling off a terminal's screen in its scrollback */
+void terminal_history_push(int32_t index, const uint16_t* row);
+
+/* Scroll the shown terminal's view rows back (negative: forward) */
+void terminal_scroll(int32_t rows);
+
+/* Return the shown terminal to its live screen */
+void terminal_scroll_live();
+
 //int32_t parent_shell_helper();
 #endif
 
@@ -0,0 +1,18 @@
+/* wait.h - wait queue type shared by the scheduler and the drivers
+ */
+
+#ifndef WAIT_H
+#define WAIT_H
+
+#include "types.h"
+
+struct pcb_t_struct;
+
+/* processes asleep on one event, linked through their sched_info_t */
+typedef struct wait_queue_t_struct
+{
+	struct pcb_t_struct* head;
+	struct pcb_t_struct* tail;
+}wait_queue_t;
+
+#endif
@@ -0,0 +1,71 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define SCRIPT_MAX 1024
+#define LINE_MAX   128
+
+static uint8_t script[SCRIPT_MAX];
+
+/* used when the image has no "benchrc" */
+static const char default_script[] =
+    "nullbench\n"
+    "openbench\n"
+    "readbench\n"
+    "execbench\n"
+    "writebench\n"
+    "sysstat\n"
+    "kstat\n";
+
+/*
+ * Benchmark runner, started instead of the shell when the kernel is booted
+ * with "bench" (see student-distrib/bench.py).  Runs every line of the file
+ * "benchrc", or of default_script if there is none, as a command, and
+ * brackets each with
+ *   benchrun cmd=<line>
+ *   benchrun status=N
+ * Returns the number of commands that failed; the kernel hands that to
+ * qemu as the exit code.
+ */
+int main ()
+{
+    uint8_t line[LINE_MAX];
+    int32_t fd, len, i, n, failed, status;
+
+    len = 0;
+    if (-1 != (fd = ece391_open ((uint8_t*)"benchrc"))) {
+        len = ece391_read (fd, script, SCRIPT_MAX - 1);
+        ece391_close (fd);
+    }
+    if (len <= 0) {
+        ece391_strcpy (script, (uint8_t*)default_script);
+        len = ece391_strlen (script);
+    }
+    script[len] = '\0';
+
+    ece391_fdputs (1, (uint8_t*)"benchrun start\n");
+    failed = 0;
+    for (i = 0; i < len; i++) {
+        for (n = 0; i < len && script[i] != '\n' && n < LINE_MAX - 1; i++)
+            line[n++] = script[i];
+        line[n] = '\0';
+        if (n == 0 || line[0] == '#')
+            continue;
+        ece391_fdputs (1, (uint8_t*)"benchrun cmd=");
+        ece391_fdputs (1, line);
+        ece391_fdputs (1, (uint8_t*)"\n");
+        status = ece391_execute (line);
+        if (status < 0)
+            ece391_fdputs (1, (uint8_t*)"benchrun status=-1");
+        else
+            ece391_put_field ((uint8_t*)"benchrun status=", status);
+        ece391_fdputs (1, (uint8_t*)"\n");
+        if (status != 0)
+            failed++;
+    }
+    ece391_put_field ((uint8_t*)"benchrun done failed=", failed);
+    ece391_fdputs (1, (uint8_t*)"\n");
+
+    return failed;
+}
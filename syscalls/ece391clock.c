@@ -0,0 +1,56 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define LOOPS 1000
+
+/*
+ * Checks the monotonic clock and what it costs to read, one line:
+ *   clock khz=N gettime_cyc=C page_cyc=C step_ns=N
+ * khz is the calibrated tsc rate, gettime_cyc/page_cyc the average cycles
+ * of a gettime system call and of a read from the time page, step_ns how
+ * far the page clock moved across the gettime loop.  Exits 1 if the two
+ * disagree or the clock went backwards.
+ */
+int main ()
+{
+    const volatile ece391_time_page_t* tp = (const volatile ece391_time_page_t*)ECE391_TIME_PAGE;
+    uint64_t sys_ns, page_ns, start_ns, end_ns;
+    uint32_t start, sys_cyc, page_cyc;
+    int32_t i, bad;
+
+    if (ece391_gettime (&sys_ns) != 0) {
+        ece391_fdputs (1, (uint8_t*)"gettime unavailable\n");
+        return 2;
+    }
+
+    bad = 0;
+    start_ns = ece391_clock_ns ();
+    start = ece391_rdtsc_lo ();
+    for (i = 0; i < LOOPS; i++)
+        ece391_gettime (&sys_ns);
+    sys_cyc = (ece391_rdtsc_lo () - start) / LOOPS;
+    end_ns = ece391_clock_ns ();
+    if (sys_ns < start_ns || sys_ns > end_ns)
+        bad = 1;
+
+    start = ece391_rdtsc_lo ();
+    for (i = 0; i < LOOPS; i++) {
+        page_ns = ece391_clock_ns ();
+        if (page_ns < end_ns)
+            bad = 1;
+        end_ns = page_ns;
+    }
+    page_cyc = (ece391_rdtsc_lo () - start) / LOOPS;
+
+    ece391_put_field ((uint8_t*)"clock khz=", tp->tsc_khz);
+    ece391_put_field ((uint8_t*)" gettime_cyc=", sys_cyc);
+    ece391_put_field ((uint8_t*)" page_cyc=", page_cyc);
+    ece391_put_field ((uint8_t*)" step_ns=", (uint32_t)(sys_ns - start_ns));
+    ece391_fdputs (1, (uint8_t*)"\n");
+    if (bad)
+        ece391_fdputs (1, (uint8_t*)"clock mismatch\n");
+
+    return bad;
+}
@@ -0,0 +1,58 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+#include "../student-distrib/sched_stats.h"
+
+#define SAMPLE_TICKS 250          /* 5 seconds of 50 Hz pit ticks */
+#define POLL_MASK    0xFFF        /* read the tick count every 4096 spins */
+#define GAP_CYCLES   0x100000     /* a longer stall means the cpu was given away */
+
+/*
+ * Context-switch latency benchmark.  Spins in user mode for SAMPLE_TICKS
+ * timer ticks while the shells of the other terminals share the cpu, then
+ * prints one line:
+ *   cswbench ticks=N switches=N avg_cyc=C max_cyc=C preempted=N
+ * avg_cyc/max_cyc are kernel-measured cycles from the switch decision to
+ * the resumed task (stack swap, esp0 and cr3 load); preempted counts the
+ * stalls this program saw in its own time-stamp counter reads.  Boot a
+ * second terminal (Alt+F2) first, otherwise there is nothing to switch to.
+ */
+int main ()
+{
+    sched_stats_t before, after;
+    uint32_t spins, prev, now, preempted, switches, cycles;
+
+    if (sizeof (before) != ece391_stats (STATS_SCHED, &before, sizeof (before))) {
+        ece391_fdputs (1, (uint8_t*)"sched stats unavailable\n");
+        return 2;
+    }
+
+    preempted = 0;
+    prev = ece391_rdtsc_lo ();
+    for (spins = 1; ; spins++) {
+        now = ece391_rdtsc_lo ();
+        if (now - prev > GAP_CYCLES)
+            preempted++;
+        prev = now;
+        if ((spins & POLL_MASK) != 0)
+            continue;
+        ece391_stats (STATS_SCHED, &after, sizeof (after));
+        if (after.ticks - before.ticks >= SAMPLE_TICKS)
+            break;
+        prev = ece391_rdtsc_lo ();     /* do not count the syscall itself */
+    }
+
+    switches = after.switches - before.switches;
+    cycles = (uint32_t)(after.switch_cycles - before.switch_cycles);
+    ece391_put_field ((uint8_t*)"cswbench ticks=", after.ticks - before.ticks);
+    ece391_put_field ((uint8_t*)" switches=", switches);
+    ece391_put_field ((uint8_t*)" avg_cyc=", (switches != 0) ? cycles / switches : 0);
+    ece391_put_field ((uint8_t*)" max_cyc=", after.max_switch_cycles);
+    ece391_put_field ((uint8_t*)" preempted=", preempted);
+    ece391_fdputs (1, (uint8_t*)"\n");
+    if (switches == 0)
+        ece391_fdputs (1, (uint8_t*)"no switches: start another terminal first\n");
+
+    return 0;
+}
@@ -0,0 +1,39 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define ITERS    100
+#define ARGSIZE  16
+
+/*
+ * execute + halt round trip.  Runs itself with the argument "child", which
+ * halts right away, ITERS times and prints one line:
+ *   bench exec iters=N us_op=N ns_op=N
+ * The time covers loading the image, the first page faults, starting the
+ * child in user mode, its halt and the return to the parent.
+ */
+int main ()
+{
+    uint8_t arg[ARGSIZE];
+    uint64_t t0, ns;
+    int32_t i;
+
+    if (0 == ece391_getargs (arg, ARGSIZE) && 0 == ece391_strcmp (arg, (uint8_t*)"child"))
+        return 0;
+
+    t0 = ece391_clock_ns ();
+    for (i = 0; i < ITERS; i++) {
+        if (0 != ece391_execute ((uint8_t*)"execbench child")) {
+            ece391_fdputs (1, (uint8_t*)"execute failed\n");
+            return 2;
+        }
+    }
+    ns = ece391_clock_ns () - t0;
+
+    ece391_put_field ((uint8_t*)"bench exec iters=", ITERS);
+    ece391_put_field ((uint8_t*)" us_op=", (uint32_t)ece391_udiv64 (ns, ITERS * 1000));
+    ece391_put_field ((uint8_t*)" ns_op=", (uint32_t)ece391_udiv64 (ns, ITERS));
+    ece391_fdputs (1, (uint8_t*)"\n");
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define SBUFSIZE 33
+#define MAXNAMES 63
+#define ROUNDS   64
+
+static uint8_t names[MAXNAMES][SBUFSIZE];
+static uint8_t miss_name[] = "nosuchfile";
+
+/*
+ * Lookup microbenchmark for the directory index.  Prints one line:
+ *   fsbench dentries=N null=C hit=C miss=C
+ * where C is the average number of cycles for a null syscall, an
+ * open+close of an existing name, and an open of a missing name.
+ * Run it on images of different directory sizes (see ../mkfsbench.sh).
+ */
+int main ()
+{
+    int32_t fd, cnt, n, i, r;
+    uint32_t t0, null_cyc, hit_cyc, miss_cyc;
+
+    /* collect all names first; dir reads share state with name lookups */
+    if (-1 == (fd = ece391_open ((uint8_t*)"."))) {
+        ece391_fdputs (1, (uint8_t*)"directory open failed\n");
+        return 2;
+    }
+    for (n = 0; n < MAXNAMES; n++) {
+        if (0 >= (cnt = ece391_read (fd, names[n], SBUFSIZE - 1)))
+            break;
+        names[n][cnt] = '\0';
+    }
+    ece391_close (fd);
+
+    /* close of fd 0 is rejected before doing any work */
+    t0 = ece391_rdtsc_lo ();
+    for (r = 0; r < ROUNDS; r++)
+        ece391_close (0);
+    null_cyc = (ece391_rdtsc_lo () - t0) / ROUNDS;
+
+    t0 = ece391_rdtsc_lo ();
+    for (r = 0; r < ROUNDS; r++) {
+        for (i = 0; i < n; i++) {
+            if (-1 != (fd = ece391_open (names[i])))
+                ece391_close (fd);
+        }
+    }
+    hit_cyc = (ece391_rdtsc_lo () - t0) / (ROUNDS * (n > 0 ? n : 1));
+
+    t0 = ece391_rdtsc_lo ();
+    for (r = 0; r < ROUNDS; r++)
+        ece391_open (miss_name);
+    miss_cyc = (ece391_rdtsc_lo () - t0) / ROUNDS;
+
+    ece391_put_field ((uint8_t*)"fsbench dentries=", n);
+    ece391_put_field ((uint8_t*)" null=", null_cyc);
+    ece391_put_field ((uint8_t*)" hit=", hit_cyc);
+    ece391_put_field ((uint8_t*)" miss=", miss_cyc);
+    ece391_fdputs (1, (uint8_t*)"\n");
+
+    return 0;
+}
@@ -0,0 +1,212 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+#include "../student-distrib/sched_stats.h"
+
+/* must match paging_stats_t in student-distrib/paging.h */
+typedef struct {
+    uint32_t exec_loads;
+    uint32_t demand_faults;
+    uint32_t cow_faults;
+    uint32_t pages_mapped;
+    uint32_t pages_copied;
+    uint32_t zero_fills;
+    uint64_t load_cycles;
+    uint64_t fault_cycles;
+} paging_stats_t;
+
+/* must match frame_stats_t in student-distrib/frame.h */
+typedef struct {
+    uint32_t total_frames;
+    uint32_t free_frames;
+    uint32_t allocs;
+    uint32_t frees;
+    uint32_t failures;
+} frame_stats_t;
+
+/* must match tlb_stats_t in student-distrib/paging.h */
+typedef struct {
+    uint32_t cr3_loads;
+    uint32_t full_flushes;
+    uint32_t invlpgs;
+    uint32_t video_remaps;
+} tlb_stats_t;
+
+/* must match rtc_stats_t in student-distrib/rtc.h */
+typedef struct {
+    uint32_t hw_ticks;
+    uint32_t scans;
+    uint32_t wakeups;
+    uint32_t rate_changes;
+    uint32_t open_files;
+} rtc_stats_t;
+
+/* must match pit_stats_t in student-distrib/pit.h */
+typedef struct {
+    uint32_t irqs;
+    uint32_t oneshots;
+    uint32_t saved_ticks;
+    uint32_t idle_saved_ticks;
+} pit_stats_t;
+
+/* must match serial_stats_t in student-distrib/serial.h */
+typedef struct {
+    uint32_t irqs;
+    uint32_t tx_bytes;
+    uint32_t rx_bytes;
+    uint32_t tx_stalls;
+    uint32_t rx_dropped;
+} serial_stats_t;
+
+/* must match kmalloc_stats_t in student-distrib/kmalloc.h */
+#define KMALLOC_CLASSES 7
+typedef struct {
+    uint32_t obj_size;
+    uint32_t inuse;
+    uint32_t allocs;
+    uint32_t frees;
+    uint32_t slabs;
+} kmalloc_class_stats_t;
+typedef struct {
+    uint32_t arena_bytes;
+    uint32_t arena_chunks;
+    uint32_t big_allocs;
+    uint32_t big_frees;
+    uint32_t big_frames;
+    uint32_t failures;
+    uint32_t bad_frees;
+    kmalloc_class_stats_t classes[KMALLOC_CLASSES];
+} kmalloc_stats_t;
+
+/*
+ * Prints the kernel statistics blocks, one line each:
+ *   paging execs=N load_kcyc=K demand=N cow=N mapped=N copied=N zero=N fault_kcyc=K
+ *   frames total=N free=N allocs=N frees=N failed=N
+ *   tlb cr3=N flush=N invlpg=N video_remap=N
+ *   sched ticks=N idle_ticks=N switches=N launches=N boosts=N sleeps=N wakeups=N idle=N
+ *         switch_kcyc=K max_switch_cyc=C
+ *   timer irqs=N oneshots=N saved_ticks=N idle_saved_ticks=N
+ *   rtc hw_ticks=N scans=N wakeups=N rate_changes=N open=N
+ *   serial irqs=N tx=B rx=B tx_stalls=N rx_dropped=N
+ *   kheap arena=B big=N/N big_frames=N failed=N bad_frees=N
+ *   kmalloc size=S inuse=N allocs=N frees=N slabs=N     (one per class)
+ * Cycle totals are in units of 1024 TSC cycles.
+ */
+int main ()
+{
+    paging_stats_t pg;
+    frame_stats_t fr;
+    static kmalloc_stats_t km;
+    tlb_stats_t tlb;
+    sched_stats_t sc;
+    rtc_stats_t rtc;
+    pit_stats_t pit;
+    serial_stats_t ser;
+    int32_t i;
+
+    if (sizeof (pg) != ece391_stats (STATS_PAGING, &pg, sizeof (pg))) {
+        ece391_fdputs (1, (uint8_t*)"paging stats unavailable\n");
+        return 2;
+    }
+    ece391_put_field ((uint8_t*)"paging execs=", pg.exec_loads);
+    ece391_put_field ((uint8_t*)" load_kcyc=", (uint32_t)(pg.load_cycles >> 10));
+    ece391_put_field ((uint8_t*)" demand=", pg.demand_faults);
+    ece391_put_field ((uint8_t*)" cow=", pg.cow_faults);
+    ece391_put_field ((uint8_t*)" mapped=", pg.pages_mapped);
+    ece391_put_field ((uint8_t*)" copied=", pg.pages_copied);
+    ece391_put_field ((uint8_t*)" zero=", pg.zero_fills);
+    ece391_put_field ((uint8_t*)" fault_kcyc=", (uint32_t)(pg.fault_cycles >> 10));
+    ece391_fdputs (1, (uint8_t*)"\n");
+
+    if (sizeof (fr) != ece391_stats (STATS_FRAMES, &fr, sizeof (fr))) {
+        ece391_fdputs (1, (uint8_t*)"frame stats unavailable\n");
+        return 2;
+    }
+    ece391_put_field ((uint8_t*)"frames total=", fr.total_frames);
+    ece391_put_field ((uint8_t*)" free=", fr.free_frames);
+    ece391_put_field ((uint8_t*)" allocs=", fr.allocs);
+    ece391_put_field ((uint8_t*)" frees=", fr.frees);
+    ece391_put_field ((uint8_t*)" failed=", fr.failures);
+    ece391_fdputs (1, (uint8_t*)"\n");
+
+    if (sizeof (tlb) != ece391_stats (STATS_TLB, &tlb, sizeof (tlb))) {
+        ece391_fdputs (1, (uint8_t*)"tlb stats unavailable\n");
+        return 2;
+    }
+    ece391_put_field ((uint8_t*)"tlb cr3=", tlb.cr3_loads);
+    ece391_put_field ((uint8_t*)" flush=", tlb.full_flushes);
+    ece391_put_field ((uint8_t*)" invlpg=", tlb.invlpgs);
+    ece391_put_field ((uint8_t*)" video_remap=", tlb.video_remaps);
+    ece391_fdputs (1, (uint8_t*)"\n");
+
+    if (sizeof (sc) != ece391_stats (STATS_SCHED, &sc, sizeof (sc))) {
+        ece391_fdputs (1, (uint8_t*)"sched stats unavailable\n");
+        return 2;
+    }
+    ece391_put_field ((uint8_t*)"sched ticks=", sc.ticks);
+    ece391_put_field ((uint8_t*)" idle_ticks=", sc.idle_ticks);
+    ece391_put_field ((uint8_t*)" switches=", sc.switches);
+    ece391_put_field ((uint8_t*)" launches=", sc.launches);
+    ece391_put_field ((uint8_t*)" boosts=", sc.boosts);
+    ece391_put_field ((uint8_t*)" sleeps=", sc.sleeps);
+    ece391_put_field ((uint8_t*)" wakeups=", sc.wakeups);
+    ece391_put_field ((uint8_t*)" idle=", sc.idle_entries);
+    ece391_put_field ((uint8_t*)" switch_kcyc=", (uint32_t)(sc.switch_cycles >> 10));
+    ece391_put_field ((uint8_t*)" max_switch_cyc=", sc.max_switch_cycles);
+    ece391_fdputs (1, (uint8_t*)"\n");
+
+    if (sizeof (pit) != ece391_stats (STATS_TIMER, &pit, sizeof (pit))) {
+        ece391_fdputs (1, (uint8_t*)"timer stats unavailable\n");
+        return 2;
+    }
+    ece391_put_field ((uint8_t*)"timer irqs=", pit.irqs);
+    ece391_put_field ((uint8_t*)" oneshots=", pit.oneshots);
+    ece391_put_field ((uint8_t*)" saved_ticks=", pit.saved_ticks);
+    ece391_put_field ((uint8_t*)" idle_saved_ticks=", pit.idle_saved_ticks);
+    ece391_fdputs (1, (uint8_t*)"\n");
+
+    if (sizeof (rtc) != ece391_stats (STATS_RTC, &rtc, sizeof (rtc))) {
+        ece391_fdputs (1, (uint8_t*)"rtc stats unavailable\n");
+        return 2;
+    }
+    ece391_put_field ((uint8_t*)"rtc hw_ticks=", rtc.hw_ticks);
+    ece391_put_field ((uint8_t*)" scans=", rtc.scans);
+    ece391_put_field ((uint8_t*)" wakeups=", rtc.wakeups);
+    ece391_put_field ((uint8_t*)" rate_changes=", rtc.rate_changes);
+    ece391_put_field ((uint8_t*)" open=", rtc.open_files);
+    ece391_fdputs (1, (uint8_t*)"\n");
+
+    if (sizeof (ser) != ece391_stats (STATS_SERIAL, &ser, sizeof (ser))) {
+        ece391_fdputs (1, (uint8_t*)"serial stats unavailable\n");
+        return 2;
+    }
+    ece391_put_field ((uint8_t*)"serial irqs=", ser.irqs);
+    ece391_put_field ((uint8_t*)" tx=", ser.tx_bytes);
+    ece391_put_field ((uint8_t*)" rx=", ser.rx_bytes);
+    ece391_put_field ((uint8_t*)" tx_stalls=", ser.tx_stalls);
+    ece391_put_field ((uint8_t*)" rx_dropped=", ser.rx_dropped);
+    ece391_fdputs (1, (uint8_t*)"\n");
+
+    if (sizeof (km) != ece391_stats (STATS_KMALLOC, &km, sizeof (km))) {
+        ece391_fdputs (1, (uint8_t*)"kmalloc stats unavailable\n");
+        return 2;
+    }
+    ece391_put_field ((uint8_t*)"kheap arena=", km.arena_bytes);
+    ece391_put_field ((uint8_t*)" big=", km.big_allocs);
+    ece391_put_field ((uint8_t*)"/", km.big_frees);
+    ece391_put_field ((uint8_t*)" big_frames=", km.big_frames);
+    ece391_put_field ((uint8_t*)" failed=", km.failures);
+    ece391_put_field ((uint8_t*)" bad_frees=", km.bad_frees);
+    ece391_fdputs (1, (uint8_t*)"\n");
+    for (i = 0; i < KMALLOC_CLASSES; i++) {
+        ece391_put_field ((uint8_t*)"kmalloc size=", km.classes[i].obj_size);
+        ece391_put_field ((uint8_t*)" inuse=", km.classes[i].inuse);
+        ece391_put_field ((uint8_t*)" allocs=", km.classes[i].allocs);
+        ece391_put_field ((uint8_t*)" frees=", km.classes[i].frees);
+        ece391_put_field ((uint8_t*)" slabs=", km.classes[i].slabs);
+        ece391_fdputs (1, (uint8_t*)"\n");
+    }
+
+    return 0;
+}
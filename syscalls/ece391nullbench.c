@@ -0,0 +1,41 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define ITERS 10000
+
+/*
+ * Null system call latency: sigreturn is rejected before doing any work,
+ * so the loop measures the int 0x80 entry, dispatch and iret.  One line:
+ *   bench null_syscall iters=N ns_op=N cyc_op=N min_cyc=N
+ */
+int main ()
+{
+    uint64_t t0;
+    uint32_t c0, c1, cyc, min_cyc, ns;
+    int32_t i;
+
+    min_cyc = 0xFFFFFFFF;
+    for (i = 0; i < ITERS / 10; i++) {
+        c0 = ece391_rdtsc_lo ();
+        ece391_sigreturn ();
+        c1 = ece391_rdtsc_lo ();
+        if (c1 - c0 < min_cyc)
+            min_cyc = c1 - c0;
+    }
+
+    t0 = ece391_clock_ns ();
+    c0 = ece391_rdtsc_lo ();
+    for (i = 0; i < ITERS; i++)
+        ece391_sigreturn ();
+    cyc = (ece391_rdtsc_lo () - c0) / ITERS;
+    ns = (uint32_t)(ece391_clock_ns () - t0) / ITERS;
+
+    ece391_put_field ((uint8_t*)"bench null_syscall iters=", ITERS);
+    ece391_put_field ((uint8_t*)" ns_op=", ns);
+    ece391_put_field ((uint8_t*)" cyc_op=", cyc);
+    ece391_put_field ((uint8_t*)" min_cyc=", min_cyc);
+    ece391_fdputs (1, (uint8_t*)"\n");
+    return 0;
+}
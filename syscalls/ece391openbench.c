@@ -0,0 +1,53 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define ITERS 1000
+
+/* one kind of file to open: the name and whether open should work */
+static const struct {
+    const char* kind;
+    const char* name;
+    int32_t exists;
+} targets[] = {
+    {"file", "frame0.txt", 1},
+    {"dir", ".", 1},
+    {"rtc", "rtc", 1},
+    {"missing", "nosuchfile", 0},
+};
+
+/*
+ * open/close cost per kind of file, one line each:
+ *   bench open kind=K iters=N ns_op=N
+ * ns_op is one open plus one close; for kind=missing it is the failed
+ * open alone.
+ */
+int main ()
+{
+    uint64_t t0;
+    uint32_t t, ns;
+    int32_t i, fd;
+
+    for (t = 0; t < sizeof (targets) / sizeof (targets[0]); t++) {
+        t0 = ece391_clock_ns ();
+        for (i = 0; i < ITERS; i++) {
+            fd = ece391_open ((uint8_t*)targets[t].name);
+            if (fd == -1) {
+                if (targets[t].exists) {
+                    ece391_fdputs (1, (uint8_t*)"open failed\n");
+                    return 2;
+                }
+                continue;
+            }
+            ece391_close (fd);
+        }
+        ns = (uint32_t)ece391_udiv64 (ece391_clock_ns () - t0, ITERS);
+        ece391_fdputs (1, (uint8_t*)"bench open kind=");
+        ece391_fdputs (1, (uint8_t*)targets[t].kind);
+        ece391_put_field ((uint8_t*)" iters=", ITERS);
+        ece391_put_field ((uint8_t*)" ns_op=", ns);
+        ece391_fdputs (1, (uint8_t*)"\n");
+    }
+    return 0;
+}
@@ -0,0 +1,50 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+#include "../student-distrib/sched_stats.h"
+
+static const char* state_names[] = {"run", "ready", "wait", "sleep"};
+
+/*
+ * Prints one line per live process:
+ *   proc pid=N ppid=N term=N state=S prio=N ticks=N disp=N expired=N credits=N sleeps=N name=S
+ * ppid is -1 for the shell a terminal started with; term counts from 1.
+ * state is run (this program), ready (on a run queue), wait (a parent
+ * waiting for its child) or sleep (blocked on input or the rtc).  prio is
+ * the feedback queue level, 0 highest.
+ */
+int main ()
+{
+    static proc_stats_t procs[PROC_MAX];
+    int32_t n, i;
+
+    n = ece391_stats (STATS_PROC, procs, sizeof (procs));
+    if (n <= 0) {
+        ece391_fdputs (1, (uint8_t*)"process stats unavailable\n");
+        return 2;
+    }
+    n /= sizeof (proc_stats_t);
+    for (i = 0; i < n; i++) {
+        ece391_put_field ((uint8_t*)"proc pid=", procs[i].pid);
+        if (procs[i].parent_pid < 0)
+            ece391_fdputs (1, (uint8_t*)" ppid=-1");
+        else
+            ece391_put_field ((uint8_t*)" ppid=", procs[i].parent_pid);
+        ece391_put_field ((uint8_t*)" term=", procs[i].terminal + 1);
+        ece391_fdputs (1, (uint8_t*)" state=");
+        ece391_fdputs (1, (uint8_t*)(procs[i].state <= PROC_SLEEPING ? state_names[procs[i].state] : "?"));
+        ece391_put_field ((uint8_t*)" prio=", procs[i].priority);
+        ece391_put_field ((uint8_t*)" ticks=", procs[i].ticks);
+        ece391_put_field ((uint8_t*)" disp=", procs[i].dispatches);
+        ece391_put_field ((uint8_t*)" expired=", procs[i].expired);
+        ece391_put_field ((uint8_t*)" credits=", procs[i].credits);
+        ece391_put_field ((uint8_t*)" sleeps=", procs[i].sleeps);
+        procs[i].name[PROC_NAME_LEN - 1] = '\0';
+        ece391_fdputs (1, (uint8_t*)" name=");
+        ece391_fdputs (1, procs[i].name);
+        ece391_fdputs (1, (uint8_t*)"\n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,65 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define MAXBUF     4096
+#define TOTAL      (256 * 1024)   /* bytes read per buffer size */
+#define ARGSIZE    64
+
+static uint8_t buf[MAXBUF];
+static const uint32_t sizes[] = {1, 16, 64, 256, 1024, 4096};
+
+/*
+ * Read throughput against the read() buffer size.  Reads the file given
+ * as argument (default "fish", the largest in the image) from start to end
+ * over and over until TOTAL bytes went through, once per buffer size, and
+ * prints one line per size:
+ *   bench read file=NAME bufsize=N bytes=N us=N kBps=N ns_call=N
+ * kBps is thousands of bytes per second.
+ */
+int main ()
+{
+    uint8_t name[ARGSIZE];
+    uint64_t t0, ns;
+    uint32_t bytes, calls, us, s;
+    int32_t fd, cnt;
+
+    if (0 != ece391_getargs (name, ARGSIZE) || name[0] == '\0')
+        ece391_strcpy (name, (uint8_t*)"fish");
+
+    for (s = 0; s < sizeof (sizes) / sizeof (sizes[0]); s++) {
+        bytes = calls = 0;
+        t0 = ece391_clock_ns ();
+        while (bytes < TOTAL) {
+            if (-1 == (fd = ece391_open (name))) {
+                ece391_fdputs (1, (uint8_t*)"file open failed\n");
+                return 2;
+            }
+            do {
+                cnt = ece391_read (fd, buf, sizes[s]);
+                calls++;
+                if (cnt > 0)
+                    bytes += cnt;
+            } while (cnt > 0);
+            ece391_close (fd);
+            if (bytes == 0) {
+                ece391_fdputs (1, (uint8_t*)"file is empty\n");
+                return 2;
+            }
+        }
+        ns = ece391_clock_ns () - t0;
+        us = (uint32_t)ece391_udiv64 (ns, 1000);
+        if (us == 0)
+            us = 1;
+        ece391_fdputs (1, (uint8_t*)"bench read file=");
+        ece391_fdputs (1, name);
+        ece391_put_field ((uint8_t*)" bufsize=", sizes[s]);
+        ece391_put_field ((uint8_t*)" bytes=", bytes);
+        ece391_put_field ((uint8_t*)" us=", us);
+        ece391_put_field ((uint8_t*)" kBps=", (uint32_t)ece391_udiv64 ((uint64_t)bytes * 1000, us));
+        ece391_put_field ((uint8_t*)" ns_call=", (uint32_t)ece391_udiv64 (ns, calls));
+        ece391_fdputs (1, (uint8_t*)"\n");
+    }
+    return 0;
+}
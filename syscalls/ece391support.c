@@ -102,3 +102,42 @@ uint8_t* ece391_strrev(uint8_t* s)
    return s;
 }
 
+/* nanoseconds since boot, read from the time page without a system call */
+uint64_t ece391_clock_ns(void)
+{
+    const volatile ece391_time_page_t* tp = (const volatile ece391_time_page_t*)ECE391_TIME_PAGE;
+    uint64_t cycles;
+    uint64_t ns;
+    uint32_t lo, hi;
+
+    if (tp->version == 0) {
+        (void)ece391_gettime (&ns);
+        return ns;
+    }
+    asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+    cycles = (((uint64_t)hi << 32) | lo) - tp->tsc_base;
+    /* (cycles * mult) >> shift without a 96-bit product; shift is below 32 */
+    return (((uint64_t)(uint32_t)(cycles >> 32) * tp->mult) << (32 - tp->shift))
+        + (((uint64_t)(uint32_t)cycles * tp->mult) >> tp->shift);
+}
+
+/* n / d; there is no libgcc, so 64-bit division is two 32-bit divides */
+uint64_t ece391_udiv64(uint64_t n, uint32_t d)
+{
+    uint32_t hi = (uint32_t)(n >> 32);
+    uint32_t qhi, qlo, r;
+
+    qhi = hi / d;
+    r = hi % d;
+    asm ("divl %4" : "=a" (qlo), "=d" (r) : "a" ((uint32_t)n), "d" (r), "rm" (d));
+    return ((uint64_t)qhi << 32) | qlo;
+}
+
+/* prints key and then val in decimal on stdout, for "name=N" report lines */
+void ece391_put_field(const uint8_t* key, uint32_t val)
+{
+    uint8_t num[16];
+
+    ece391_fdputs(1, key);
+    ece391_fdputs(1, ece391_itoa(val, num, 10));
+}
@@ -8,6 +8,18 @@ extern int32_t ece391_strcmp(const uint8_t* s1, const uint8_t* s2);
 extern int32_t ece391_strncmp(const uint8_t* s1, const uint8_t* s2, uint32_t n);
 extern uint8_t *ece391_itoa(uint32_t value, uint8_t* buf, int32_t radix);
 extern uint8_t *ece391_strrev(uint8_t* s);
+extern uint64_t ece391_clock_ns(void);
+extern uint64_t ece391_udiv64(uint64_t n, uint32_t d);
+extern void ece391_put_field(const uint8_t* key, uint32_t val);
+
+/* low 32 bits of the time-stamp counter; differences of two reads are used.
+   Inline so a timed loop does not also time a call. */
+static inline uint32_t ece391_rdtsc_lo(void)
+{
+    uint32_t lo, hi;
+    asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+    return lo;
+}
 
 #endif /* ECE391SUPPORT_H */
 
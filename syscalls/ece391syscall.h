@@ -21,6 +21,27 @@ extern int32_t ece391_getargs (uint8_t* buf, int32_t nbytes);
 extern int32_t ece391_vidmap (uint8_t** screen_start);
 extern int32_t ece391_set_handler (int32_t signum, void* handler);
 extern int32_t ece391_sigreturn (void);
+/* copies up to nbytes of the kernel statistics block "kind"; returns bytes copied */
+extern int32_t ece391_stats (int32_t kind, void* buf, int32_t nbytes);
+/* stores nanoseconds since boot in *ns */
+extern int32_t ece391_gettime (uint64_t* ns);
+/* copies the system call counters of process pid (-1: all processes); returns bytes copied */
+extern int32_t ece391_sysstats (int32_t pid, void* buf, int32_t nbytes);
+
+/*
+ * The same clock without a trap: every process has this read-only page at
+ * ECE391_TIME_PAGE.  ns = ((tsc - tsc_base) * mult) >> shift; version is 0
+ * until the kernel has calibrated the clock.  Must match clock_page_t in
+ * student-distrib/clock.h.  ece391_clock_ns() does the arithmetic.
+ */
+#define ECE391_TIME_PAGE 0x08400000
+typedef struct {
+	uint32_t version;
+	uint32_t tsc_khz;
+	uint32_t mult;
+	uint32_t shift;
+	uint64_t tsc_base;
+} ece391_time_page_t;
 
 enum signums {
 	DIV_ZERO = 0,
@@ -31,5 +52,18 @@ enum signums {
 	NUM_SIGNALS
 };
 
+enum stat_kinds {
+	STATS_PAGING = 0,
+	STATS_FRAMES,
+	STATS_KMALLOC,
+	STATS_TLB,
+	STATS_SCHED,
+	STATS_PROC,
+	STATS_RTC,
+	STATS_TIMER,
+	STATS_SERIAL,
+	NUM_STATS
+};
+
 #endif /* ECE391SYSCALL_H */
 
@@ -0,0 +1,99 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+#include "../student-distrib/sched_stats.h"
+
+#define SYSCALLS      13
+#define HIST_BUCKETS  32
+
+/* must match syscall_stat_t / syscall_stats_t in student-distrib/syscall.h */
+typedef struct {
+    uint32_t calls;
+    uint32_t errors;
+    uint32_t max_cycles;
+    uint64_t cycles;
+    uint32_t hist[HIST_BUCKETS];
+} syscall_stat_t;
+typedef struct {
+    syscall_stat_t sys[SYSCALLS];
+} syscall_stats_t;
+
+static const char* sys_names[SYSCALLS] = {
+    "halt", "execute", "read", "write", "open", "close", "getargs",
+    "vidmap", "set_handler", "sigreturn", "stats", "gettime", "sysstats"
+};
+
+/* total / calls without 64-bit division: drop low bits until the total fits */
+static uint32_t average (uint64_t total, uint32_t calls)
+{
+    uint32_t shift = 0;
+
+    if (calls == 0)
+        return 0;
+    while ((total >> shift) >> 32)
+        shift++;
+    return ((uint32_t)(total >> shift) / calls) << shift;
+}
+
+static void print_stats (const uint8_t* who, const syscall_stats_t* st)
+{
+    const syscall_stat_t* s;
+    int32_t i, b;
+
+    for (i = 0; i < SYSCALLS; i++) {
+        s = &st->sys[i];
+        if (s->calls == 0)
+            continue;
+        ece391_fdputs (1, (uint8_t*)"sys ");
+        ece391_fdputs (1, who);
+        ece391_fdputs (1, (uint8_t*)" ");
+        ece391_fdputs (1, (uint8_t*)sys_names[i]);
+        ece391_put_field ((uint8_t*)" calls=", s->calls);
+        ece391_put_field ((uint8_t*)" err=", s->errors);
+        ece391_put_field ((uint8_t*)" avg_cyc=", average (s->cycles, s->calls));
+        ece391_put_field ((uint8_t*)" max_cyc=", s->max_cycles);
+        ece391_fdputs (1, (uint8_t*)" hist=");
+        for (b = 0; b < HIST_BUCKETS; b++) {
+            if (s->hist[b] == 0)
+                continue;
+            ece391_put_field ((uint8_t*)"", b);
+            ece391_put_field ((uint8_t*)":", s->hist[b]);
+            ece391_fdputs (1, (uint8_t*)",");
+        }
+        ece391_fdputs (1, (uint8_t*)"\n");
+    }
+}
+
+/*
+ * Prints the system call counters, system-wide and for every live process,
+ * one line per system call that was used:
+ *   sys all|pid=N name calls=N err=N avg_cyc=C max_cyc=C hist=B:N,B:N,...
+ * hist lists the non-empty log2 buckets: B:N means N calls took between
+ * 2^B and 2^(B+1) cycles.  Cycles run from the int 0x80 entry to the
+ * return; a read that blocked for input counts the wait.
+ */
+int main ()
+{
+    static syscall_stats_t st;
+    static proc_stats_t procs[PROC_MAX];
+    uint8_t who[16] = "pid=";
+    int32_t n, i;
+
+    if (sizeof (st) != ece391_sysstats (-1, &st, sizeof (st))) {
+        ece391_fdputs (1, (uint8_t*)"syscall stats unavailable\n");
+        return 2;
+    }
+    print_stats ((uint8_t*)"all", &st);
+
+    n = ece391_stats (STATS_PROC, procs, sizeof (procs));
+    n = (n > 0) ? n / sizeof (proc_stats_t) : 0;
+    for (i = 0; i < n; i++) {
+        if (sizeof (st) != ece391_sysstats (procs[i].pid, &st, sizeof (st)))
+            continue;
+        ece391_itoa (procs[i].pid, who + 4, 10);
+        print_stats (who, &st);
+    }
+
+    return 0;
+}
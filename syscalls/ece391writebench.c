@@ -0,0 +1,58 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define LINE_LEN   80
+#define LINES      200
+#define SINGLES    2000
+
+static uint8_t line[LINE_LEN];
+
+static void report (uint32_t chunk, uint32_t bytes, uint64_t ns)
+{
+    uint32_t us = (uint32_t)ece391_udiv64 (ns, 1000);
+
+    if (us == 0)
+        us = 1;
+    ece391_put_field ((uint8_t*)"bench write chunk=", chunk);
+    ece391_put_field ((uint8_t*)" bytes=", bytes);
+    ece391_put_field ((uint8_t*)" us=", us);
+    ece391_put_field ((uint8_t*)" kBps=", (uint32_t)ece391_udiv64 ((uint64_t)bytes * 1000, us));
+    ece391_put_field ((uint8_t*)" ns_call=", (uint32_t)ece391_udiv64 (ns, bytes / chunk));
+    ece391_put_field ((uint8_t*)" lines_per_s=", (uint32_t)ece391_udiv64 ((uint64_t)(bytes / LINE_LEN) * 1000000, us));
+    ece391_fdputs (1, (uint8_t*)"\n");
+}
+
+/*
+ * Terminal write throughput.  Writes LINES full lines (so every one
+ * scrolls the screen), then SINGLES one-byte writes, and afterwards prints
+ * one line per pattern:
+ *   bench write chunk=N bytes=N us=N kBps=N ns_call=N lines_per_s=N
+ * Every LINE_LEN bytes end a line, so lines_per_s is the rate cat or grep
+ * output scrolls by.
+ */
+int main ()
+{
+    uint64_t t0, line_ns, single_ns;
+    int32_t i;
+
+    for (i = 0; i < LINE_LEN - 1; i++)
+        line[i] = 'a' + i % 26;
+    line[LINE_LEN - 1] = '\n';
+
+    t0 = ece391_clock_ns ();
+    for (i = 0; i < LINES; i++)
+        ece391_write (1, line, LINE_LEN);
+    line_ns = ece391_clock_ns () - t0;
+
+    t0 = ece391_clock_ns ();
+    for (i = 0; i < SINGLES; i++)
+        ece391_write (1, (i % LINE_LEN == LINE_LEN - 1) ? "\n" : "x", 1);
+    single_ns = ece391_clock_ns () - t0;
+
+    ece391_fdputs (1, (uint8_t*)"\n");
+    report (LINE_LEN, LINE_LEN * LINES, line_ns);
+    report (1, SINGLES, single_ns);
+    return 0;
+}